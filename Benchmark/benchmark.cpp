@@ -0,0 +1,645 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "BigInt.h"
+#include "BigIntBatch.h"
+#include "BigIntConstantTime.h"
+#include "BigIntFixed.h"
+#include "BigIntModulus.h"
+#include "BigIntSerialization.h"
+#include "BigIntThreadPool.h"
+
+/*
+ * Performance suite of the BigInt operators.
+ * Every benchmark sweeps the operand size from 64 bits to 10M bits and reports,
+ * next to the time per operation, the heap traffic per operation (allocs_per_op
+ * and bytes_per_op) counted by the global operator new below.
+ * Run with --benchmark_format=json (or build the bigint_benchmarks_json target)
+ * to keep the results across releases.
+ */
+
+#pragma region allocation-counting
+namespace
+{
+	std::atomic<uint64_t> g_allocations{ 0 };
+	std::atomic<uint64_t> g_allocated_bytes{ 0 };
+
+	void* counted_allocation(std::size_t size, std::size_t alignment = 0)
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+		size = size != 0 ? size : 1;
+		// aligned_alloc wants a size multiple of the alignment
+		void* const p = alignment == 0 ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+		if (p == nullptr)
+			throw std::bad_alloc();
+		return p;
+	}
+}
+
+// The default memory resource, behind the BigInt digits, uses the aligned forms
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return counted_allocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void* operator new(std::size_t size)
+{
+	return counted_allocation(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return counted_allocation(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+namespace
+{
+	// Heap traffic of the timed loop, reported per iteration
+	class AllocationCounter
+	{
+	public:
+		AllocationCounter()
+			: m_allocations(g_allocations.load()), m_bytes(g_allocated_bytes.load())
+		{
+		}
+		void report(benchmark::State& state) const
+		{
+			state.counters["allocs_per_op"] = benchmark::Counter(static_cast<double>(g_allocations.load() - m_allocations), benchmark::Counter::kAvgIterations);
+			state.counters["bytes_per_op"] = benchmark::Counter(static_cast<double>(g_allocated_bytes.load() - m_bytes), benchmark::Counter::kAvgIterations);
+		}
+	private:
+		uint64_t m_allocations;
+		uint64_t m_bytes;
+	};
+}
+#pragma endregion
+
+#pragma region operands
+namespace
+{
+	constexpr int64_t MIN_BITS = 64;
+	constexpr int64_t MAX_BITS = 10000000;
+
+	// Random value of exactly bits bits (top bit set), the same for a given seed
+	BigInt random_bits(std::mt19937_64& generator, int64_t bits)
+	{
+		if (bits <= 62)
+		{
+			const uint64_t mask = (uint64_t(1) << bits) - 1;
+			return static_cast<long long>((generator() & mask) | (uint64_t(1) << (bits - 1)));
+		}
+		// Build the halves separately so that the cost stays quasi-linear
+		const int64_t low_bits = bits / 2;
+		BigInt low = random_bits(generator, low_bits);
+		if (std::uniform_int_distribution<int>(0, 1)(generator) == 0)
+			low -= BigInt(1) << (low_bits - 1);
+		return (random_bits(generator, bits - low_bits) << low_bits) | low;
+	}
+
+	BigInt operand(int64_t bits, uint64_t seed)
+	{
+		std::mt19937_64 generator(seed * 1000003 + bits);
+		return random_bits(generator, bits);
+	}
+
+	void size_sweep(benchmark::internal::Benchmark* b)
+	{
+		b->RangeMultiplier(8)->Range(MIN_BITS, MAX_BITS)->Unit(benchmark::kMicrosecond);
+	}
+
+	void set_bits(benchmark::State& state, int64_t bits)
+	{
+		state.counters["bits"] = static_cast<double>(bits);
+	}
+}
+#pragma endregion
+
+#pragma region arithmetic
+static void BM_Addition(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a + b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Addition)->Apply(size_sweep);
+
+static void BM_Subtraction(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a - b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Subtraction)->Apply(size_sweep);
+
+static void BM_Multiplication(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a * b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Multiplication)->Apply(size_sweep);
+
+static void BM_Square(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a * a);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Square)->Apply(size_sweep);
+
+// The dividend has the given size, the divisor half of it
+static void BM_Division(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0) / 2, 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a / b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Division)->Apply(size_sweep);
+
+static void BM_Modulo(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0) / 2, 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a % b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Modulo)->Apply(size_sweep);
+
+// A 61 bit base raised to the exponent that gives a result of the given size
+static void BM_Power(benchmark::State& state)
+{
+	const BigInt base = 2305843009213693951LL;
+	const int exponent = static_cast<int>(state.range(0) / 61);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(pow(base, exponent));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Power)->Apply(size_sweep);
+
+static void BM_Increment(benchmark::State& state)
+{
+	BigInt a = operand(state.range(0), 1);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(++a);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Increment)->Apply(size_sweep);
+#pragma endregion
+
+#pragma region modular
+// Full size exponents modulo an odd modulus of the given size, the key sizes of RSA
+static void modular_sizes(benchmark::internal::Benchmark* b)
+{
+	b->RangeMultiplier(2)->Range(256, 4096)->Unit(benchmark::kMicrosecond);
+}
+
+static void BM_PowMod(benchmark::State& state)
+{
+	const Modulus modulus(operand(state.range(0), 1) | 1);
+	const BigInt base = operand(state.range(0) - 1, 2);
+	const BigInt exponent = operand(state.range(0), 3);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(modulus.pow(base, exponent));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_PowMod)->Apply(modular_sizes);
+
+static void BM_ConstantTimePowMod(benchmark::State& state)
+{
+	const size_t limbs = static_cast<size_t>(state.range(0) / 64);
+	const ConstantTimeModulus modulus(operand(state.range(0), 1) | 1);
+	const ConstantTimeInt base(operand(state.range(0) - 1, 2), limbs);
+	const ConstantTimeInt exponent(operand(state.range(0), 3), limbs);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(modulus.pow(base, exponent));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ConstantTimePowMod)->Apply(modular_sizes);
+
+static void BM_Gcd(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(gcd(a, b));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Gcd)->RangeMultiplier(4)->Range(256, 1 << 20)->Unit(benchmark::kMicrosecond);
+#pragma endregion
+
+#pragma region batch
+// Batches of 10000 values of the given size
+static void batch_sizes(benchmark::internal::Benchmark* b)
+{
+	b->RangeMultiplier(8)->Range(64, 32768)->Unit(benchmark::kMillisecond);
+}
+
+static std::vector<BigInt> batch(int64_t bits)
+{
+	std::vector<BigInt> values;
+	for (uint64_t i = 0; i < 10000; ++i)
+		values.push_back(operand(bits, i));
+	return values;
+}
+
+static void BM_Sum(benchmark::State& state)
+{
+	const std::vector<BigInt> values = batch(state.range(0));
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(sum(values));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Sum)->Apply(batch_sizes);
+
+static void BM_Product(benchmark::State& state)
+{
+	const std::vector<BigInt> values = batch(state.range(0));
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(product(values));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+// The product grows to 10000 times the size of the values
+BENCHMARK(BM_Product)->RangeMultiplier(8)->Range(64, 512)->Unit(benchmark::kMillisecond);
+#pragma endregion
+
+#pragma region fixed-width
+// The fixed width values against BigInt on the same operands, at the widths of keys and hashes
+template <size_t Bits>
+static void BM_FixedAddition(benchmark::State& state)
+{
+	FixedBigInt<Bits> a(operand(Bits, 1));
+	const FixedBigInt<Bits> b(operand(Bits, 2));
+	for (auto _ : state)
+	{
+		a += b;
+		benchmark::DoNotOptimize(a);
+	}
+	set_bits(state, Bits);
+}
+BENCHMARK_TEMPLATE(BM_FixedAddition, 256);
+BENCHMARK_TEMPLATE(BM_FixedAddition, 512);
+BENCHMARK_TEMPLATE(BM_FixedAddition, 4096);
+
+template <size_t Bits>
+static void BM_FixedMultiplication(benchmark::State& state)
+{
+	const FixedBigInt<Bits> a(operand(Bits, 1));
+	const FixedBigInt<Bits> b(operand(Bits, 2));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a * b);
+	set_bits(state, Bits);
+}
+BENCHMARK_TEMPLATE(BM_FixedMultiplication, 256);
+BENCHMARK_TEMPLATE(BM_FixedMultiplication, 512);
+BENCHMARK_TEMPLATE(BM_FixedMultiplication, 4096);
+
+template <size_t Bits>
+static void BM_FixedDivision(benchmark::State& state)
+{
+	const FixedBigInt<Bits> a(operand(Bits, 1));
+	const FixedBigInt<Bits> b(operand(Bits / 2, 2));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a / b);
+	set_bits(state, Bits);
+}
+BENCHMARK_TEMPLATE(BM_FixedDivision, 256);
+BENCHMARK_TEMPLATE(BM_FixedDivision, 512);
+BENCHMARK_TEMPLATE(BM_FixedDivision, 4096);
+#pragma endregion
+
+#pragma region parallel
+// Multi-million bit operands against the number of pool threads (0 runs serially).
+// Wall clock time: the work happens on the pool threads
+static void parallel_sizes(benchmark::internal::Benchmark* b)
+{
+	for (int64_t bits : { int64_t(1) << 20, int64_t(1) << 23 })
+	{
+		for (int64_t threads : { 0, 2, 4, 8, 16, 32 })
+			b->Args({ bits, threads });
+	}
+	b->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+static void BM_ParallelMultiplication(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	BigIntThreadPool pool(state.range(1) > 0 ? static_cast<size_t>(state.range(1)) : 1);
+	BigIntThreadPool* const previous = BigInt::set_thread_pool(state.range(1) > 0 ? &pool : nullptr);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a * b);
+	BigInt::set_thread_pool(previous);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ParallelMultiplication)->Apply(parallel_sizes);
+
+static void BM_ParallelDivision(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0) / 2, 2);
+	BigIntThreadPool pool(state.range(1) > 0 ? static_cast<size_t>(state.range(1)) : 1);
+	BigIntThreadPool* const previous = BigInt::set_thread_pool(state.range(1) > 0 ? &pool : nullptr);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a / b);
+	BigInt::set_thread_pool(previous);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ParallelDivision)->Apply(parallel_sizes);
+#pragma endregion
+
+#pragma region bitwise-operators
+static void BM_And(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a & b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_And)->Apply(size_sweep);
+
+static void BM_Or(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a | b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Or)->Apply(size_sweep);
+
+static void BM_Xor(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = operand(state.range(0), 2);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a ^ b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Xor)->Apply(size_sweep);
+
+// Shifts by a count that is not a multiple of the digit size
+static void BM_LeftShift(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const size_t count = static_cast<size_t>(state.range(0) / 2 + 3);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a << count);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_LeftShift)->Apply(size_sweep);
+
+static void BM_RightShift(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const size_t count = static_cast<size_t>(state.range(0) / 2 + 3);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a >> count);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_RightShift)->Apply(size_sweep);
+#pragma endregion
+
+#pragma region comparison
+// Operands that only differ in the least significant digit, the worst case
+static void BM_LessThan(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = a + 1;
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a < b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_LessThan)->Apply(size_sweep);
+
+static void BM_Equality(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	const BigInt b = a;
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a == b);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_Equality)->Apply(size_sweep);
+#pragma endregion
+
+#pragma region conversions
+static void BM_ToString(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(static_cast<std::string>(a));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ToString)->Apply(size_sweep);
+
+static void BM_FromString(benchmark::State& state)
+{
+	const std::string s = static_cast<std::string>(operand(state.range(0), 1));
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(BigInt(s));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_FromString)->Apply(size_sweep);
+
+static void BM_ToChars(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	std::vector<char> out(static_cast<std::string>(a).size());
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(to_chars(out.data(), out.data() + out.size(), a).ptr);
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ToChars)->Apply(size_sweep);
+
+static void BM_StreamIn(benchmark::State& state)
+{
+	const std::string s = static_cast<std::string>(operand(state.range(0), 1));
+	BigInt value;
+	AllocationCounter counter;
+	for (auto _ : state)
+	{
+		std::istringstream in(s);
+		in >> value;
+		benchmark::DoNotOptimize(value);
+	}
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_StreamIn)->Apply(size_sweep);
+
+static void BM_ToBytes(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	std::vector<std::byte> out(a.byte_size());
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(a.to_bytes(out.data(), out.size()));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ToBytes)->Apply(size_sweep);
+
+static void BM_FromBytes(benchmark::State& state)
+{
+	const BigInt a = operand(state.range(0), 1);
+	std::vector<std::byte> bytes(a.byte_size());
+	a.to_bytes(bytes.data(), bytes.size());
+	AllocationCounter counter;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(BigInt::from_bytes(bytes.data(), bytes.size()));
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_FromBytes)->Apply(size_sweep);
+
+// A batch of 10000 values through the compact encoding
+static void BM_WriteValues(benchmark::State& state)
+{
+	const std::vector<BigInt> values = batch(state.range(0));
+	AllocationCounter counter;
+	for (auto _ : state)
+	{
+		std::ostringstream out;
+		BigIntWriter writer(out);
+		writer.write(values);
+		writer.flush();
+		benchmark::DoNotOptimize(out.tellp());
+	}
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_WriteValues)->Apply(batch_sizes);
+
+static void BM_ReadValues(benchmark::State& state)
+{
+	std::ostringstream out;
+	{
+		BigIntWriter writer(out);
+		writer.write(batch(state.range(0)));
+	}
+	const std::string bytes = out.str();
+	std::vector<BigInt> values(10000);
+	AllocationCounter counter;
+	for (auto _ : state)
+	{
+		BigIntReader reader(reinterpret_cast<const std::byte*>(bytes.data()), bytes.size());
+		benchmark::DoNotOptimize(reader.read(values.data(), values.size()));
+	}
+	counter.report(state);
+	set_bits(state, state.range(0));
+}
+BENCHMARK(BM_ReadValues)->Apply(batch_sizes);
+#pragma endregion
+
+BENCHMARK_MAIN();
@@ -1,119 +1,434 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
-#include <functional>
+#include <deque>
 #include <iostream>
-#include <sstream>
+#include <memory_resource>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
-#include "include\BigInt.h"
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+#include "include/BigIntPower.h"
+
+using bigint_detail::add_with_carry;
+using bigint_detail::sub_with_borrow;
+using bigint_detail::mul_add;
 
 #pragma region constructors
-BigInt::BigInt() : m_sign(Sign::positive), m_digits(1, 0)
+BigInt::BigInt() : m_digits(1, 0)
 {
 	
 }
 
-BigInt::BigInt(long long num) : m_sign(num >= 0 ? Sign::positive : Sign::negative)
+BigInt::BigInt(long long num)
 {
-	// Remove the sign to easily push the digits without weird conversions and log10 operation
-	num = std::abs(num);
-	if(num < BIGINT_BASE)
-	{
-		m_digits = std::vector<digit_t>(1, num);
-		return;
-	}
-	if(num == BIGINT_BASE)
+	// Any long long magnitude fits in a single digit. The magnitude is computed in
+	// unsigned arithmetic so that the most negative value does not overflow
+	const digit_t magnitude = num >= 0 ? static_cast<digit_t>(num) : 0 - static_cast<digit_t>(num);
+	m_digits.assign(&magnitude, &magnitude + 1);
+	set_sign(num >= 0 ? Sign::positive : Sign::negative);
+}
+
+BigInt::BigInt(const std::string& s) : m_digits(1, 0)
+{
+	// Only a leading minus sign is accepted before the digits
+	const char* first = s.data();
+	const char* const last = s.data() + s.size();
+	const bool minus = first != last && *first == '-';
+	if (minus)
+		++first;
+	for (const char* it = first; it != last; ++it)
 	{
-		m_digits = { 0, 1 };
-		return;
+		if (*it < '0' || *it > '9')
+			throw std::invalid_argument("Invalid input format string for BigInt. Only digits [0-9] are allowed.");
 	}
-	// Reserve space for the digits and set to 0 their 
-	//const int n = num == 0 ? 1 : 1 + static_cast<int>(std::log10(num));
-	//m_digits.reserve(n);
-	BigInt temp = 0;
-	BigInt base = 1;
-	do
-	{
-		//m_digits.push_back(num % 10);
-		temp += base*(num % 10);
-		num /= 10;
-		base *= 10;
-	} while (num > 0);
-	temp.m_sign = m_sign;
+	BigInt temp = from_decimal(first, last);
+	temp.set_sign(minus ? Sign::negative : Sign::positive);
+	temp.remove_leading_zeros();
 	std::swap(*this, temp);
 }
+#pragma endregion
 
-BigInt::BigInt(const std::string& s) : m_sign((s[0] == '-' && s[1] != '0') ? Sign::negative : Sign::positive), m_digits(1, 0)
+
+
+#pragma region conversions
+/*
+ * Radix conversion works on chunks of DECIMAL_CHUNK_DIGITS decimal digits, the
+ * largest power of ten that fits in a digit. Values of at least
+ * BigIntThresholds::dc_radix digits are split in two halves around a power
+ * 10^(DECIMAL_CHUNK_DIGITS * 2^k) taken from a cache shared by all the
+ * conversions, so both directions cost a few multiplications or divisions.
+ * The text goes through a sink, which receives it in order: a string, a stream or
+ * a caller buffer, without building the whole text elsewhere first.
+ */
+namespace
 {
-	//m_digits.reserve(s.length() + 1);
-	// Push back the string in reverse order
-	BigInt temp = 0;
-	BigInt base = 1;
-	for(auto it = s.rbegin(); it != s.rend(); ++it)
+	constexpr size_t DECIMAL_CHUNK_DIGITS = 19;
+	constexpr uint64_t DECIMAL_CHUNK = 10000000000000000000ull;
+	// operator>> converts the digits in blocks of decimal_power_digits(STREAM_BLOCK_POWER)
+	constexpr size_t STREAM_BLOCK_POWER = 10;
+
+	// 10^(DECIMAL_CHUNK_DIGITS * 2^k), computed once and kept for the following conversions
+	const BigInt& decimal_power(size_t k)
 	{
-		if((it == s.rend()-1) && *it == '-')
-			continue;	// is eventually the last loop...
-		if (*it >= '0' && *it <= '9')
+		static std::mutex mutex;
+		// A deque never moves its elements, the returned references stay valid
+		static std::deque<BigInt> powers;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (powers.empty())
 		{
-			temp += base * (*it - '0');
-			base *= 10;
-			//m_digits.push_back(*it - '0');
+			powers.push_back(BigInt(static_cast<long long>(DECIMAL_CHUNK / 10)) * BigInt(10));
 		}
-		else
-			throw std::exception("Invalid input format string for BigInt. Only digits [0-9] are allowed.");
+		while (powers.size() <= k)
+		{
+			powers.push_back(powers.back() * powers.back());
+		}
+		return powers[k];
+	}
+
+	size_t decimal_power_digits(size_t k)
+	{
+		return DECIMAL_CHUNK_DIGITS << k;
 	}
-	temp.m_sign = m_sign;
-	std::swap(*this, temp);
-}
-#pragma endregion
 
+	// Approximate number of digits (limbs) of decimal_power(k), without computing it
+	double decimal_power_limbs(size_t k)
+	{
+		return decimal_power_digits(k) * 3.3219280948873623 / BIGINT_DIGIT_BITS;
+	}
 
+	bool is_decimal_digit(int c)
+	{
+		return c >= '0' && c <= '9';
+	}
 
-std::ostream& operator<<(std::ostream& out, const BigInt& big)
+	class StringSink
+	{
+	public:
+		explicit StringSink(std::string& out) : m_out(out)
+		{
+		}
+		void write(const char* text, size_t size)
+		{
+			m_out.append(text, size);
+		}
+		void zeros(size_t count)
+		{
+			m_out.append(count, '0');
+		}
+
+	private:
+		std::string& m_out;
+	};
+
+	class StreamSink
+	{
+	public:
+		explicit StreamSink(std::ostream& out) : m_out(out)
+		{
+		}
+		void write(const char* text, size_t size)
+		{
+			m_out.write(text, static_cast<std::streamsize>(size));
+		}
+		void zeros(size_t count)
+		{
+			static const char ZEROS[] = "0000000000000000000000000000000000000000000000000000000000000000";
+			for (; count > 0; count -= std::min(count, sizeof(ZEROS) - 1))
+				write(ZEROS, std::min(count, sizeof(ZEROS) - 1));
+		}
+
+	private:
+		std::ostream& m_out;
+	};
+
+	// Writes to [first, last) and remembers when the text does not fit
+	class BufferSink
+	{
+	public:
+		BufferSink(char* first, char* last) : m_next(first), m_last(last), m_overflow(false)
+		{
+		}
+		void write(const char* text, size_t size)
+		{
+			if (reserve(size))
+				m_next = std::copy(text, text + size, m_next);
+		}
+		void zeros(size_t count)
+		{
+			if (reserve(count))
+				m_next = std::fill_n(m_next, count, '0');
+		}
+		char* next() const
+		{
+			return m_next;
+		}
+		bool overflow() const
+		{
+			return m_overflow;
+		}
+
+	private:
+		char* m_next;
+		char* m_last;
+		bool m_overflow;
+
+		bool reserve(size_t size)
+		{
+			m_overflow = m_overflow || static_cast<size_t>(m_last - m_next) < size;
+			return !m_overflow;
+		}
+	};
+}
+
+BigInt BigInt::from_decimal(const char* first, const char* last)
 {
-	out << static_cast<std::string>(big);
-	return out;
+	const size_t length = last - first;
+	if (length < thresholds().dc_radix * DECIMAL_CHUNK_DIGITS)
+	{
+		// Horner's scheme on whole chunks: result = result * 10^19 + chunk
+		BigInt result;
+		result.m_digits.reserve(length / DECIMAL_CHUNK_DIGITS + 1);
+		// The first chunk takes the digits that do not fill a whole chunk
+		size_t chunk_length = length % DECIMAL_CHUNK_DIGITS;
+		if (chunk_length == 0)
+			chunk_length = DECIMAL_CHUNK_DIGITS;
+		const char* it = first;
+		while (it != last)
+		{
+			digit_t chunk = 0;
+			digit_t scale = 1;
+			for (const char* const end = it + chunk_length; it != end; ++it)
+			{
+				chunk = chunk * 10 + (*it - '0');
+				scale *= 10;
+			}
+			digit_t carry = bigint_detail::mul_1(result.m_digits.data(), result.m_digits.data(), result.num_digits(), scale);
+			carry += bigint_detail::add_1(result.m_digits.data(), result.m_digits.data(), result.num_digits(), chunk);
+			if (carry > 0)
+				result.add_digit(carry);
+			chunk_length = DECIMAL_CHUNK_DIGITS;
+		}
+		return result.remove_leading_zeros();
+	}
+	// Split the digits so that the low part is exactly a cached power of ten long
+	size_t k = 0;
+	while (decimal_power_digits(k + 1) < length)
+		++k;
+	const char* const middle = last - decimal_power_digits(k);
+	BigInt result = from_decimal(first, middle);
+	result *= decimal_power(k);
+	result += from_decimal(middle, last);
+	return result;
+}
+
+template <class Sink>
+void BigInt::to_decimal(Sink& sink, size_t width) const
+{
+	if (num_digits() < thresholds().dc_radix)
+	{
+		// Peel 19 decimal digits at a time dividing by 10^19, writing the text backwards
+		// from the end of a buffer holding (n + 1) * 20 characters, more than n limbs need
+		bigint_detail::LimbVector magnitude(m_digits);
+		size_t n = bigint_detail::normalized_size(magnitude.data(), magnitude.size());
+		const size_t capacity = (n + 1) * 20;
+		char local[(bigint_detail::LimbVector::INLINE_LIMBS + 1) * 20];
+		std::string heap;
+		char* text = local;
+		if (capacity > sizeof(local))
+		{
+			heap.resize(capacity);
+			text = &heap[0];
+		}
+		char* const end = text + capacity;
+		char* begin = end;
+		while (n > 0)
+		{
+			digit_t chunk = bigint_detail::div_1(magnitude.data(), magnitude.data(), n, DECIMAL_CHUNK);
+			n = bigint_detail::normalized_size(magnitude.data(), n);
+			for (size_t j = 0; j < DECIMAL_CHUNK_DIGITS; ++j, chunk /= 10)
+				*--begin = static_cast<char>('0' + chunk % 10);
+		}
+		// The most significant chunk is not zero: only its leading zeros go
+		while (begin != end && *begin == '0')
+			++begin;
+		const size_t written = end - begin;
+		if (written < width)
+			sink.zeros(width - written);
+		else if (written == 0)
+			sink.zeros(1);
+		sink.write(begin, written);
+		return;
+	}
+	// Split around the cached power of ten closest to the square root of the value
+	size_t k = 0;
+	while (2 * decimal_power_limbs(k + 1) <= num_digits())
+		++k;
+	const std::pair<BigInt, BigInt> parts = divmod(*this, decimal_power(k));
+	const size_t low_width = decimal_power_digits(k);
+	parts.first.to_decimal(sink, width > low_width ? width - low_width : 0);
+	parts.second.to_decimal(sink, low_width);
 }
 
-#pragma region conversions
 /*
  * This function convert a BigInt to std::string
  */
 BigInt::operator std::string() const
 {
-	std::stringstream s("");
-	//if (is_negative())
-	//	s << "-";
-	/*for(int k = num_digits()-1; k >= 0; --k)
-	{
-		s << static_cast<char>('0' + get_digit(k));
-	}*/
-	BigInt temp(*this);
-	temp.m_sign = Sign::positive;
-	do
-	{
-		//m_digits.push_back(num % 10);
-		BigInt remind = temp % 10;
-		s << static_cast<char>('0' + remind.get_digit(0));
-		temp /= 10;
-	} while (temp > 0);
+	std::string s;
+	// Every digit holds a bit less than 19.3 decimal digits
+	s.reserve(num_digits() * 20 + 1);
 	if (is_negative())
-		s << "-";
-	const std::string reversed_string = s.str();
-	// Revert the string for human-reading
-	return std::string(reversed_string.rbegin(), reversed_string.rend());
+		s.push_back('-');
+	StringSink sink(s);
+	to_decimal(sink, 0);
+	return s;
+}
+
+std::ostream& operator<<(std::ostream& out, const BigInt& big)
+{
+	// Padding to a field width needs the length of the text
+	if (out.width() > 0)
+	{
+		out << static_cast<std::string>(big);
+		return out;
+	}
+	const std::ostream::sentry sentry(out);
+	if (sentry)
+	{
+		if (big.is_negative())
+			out.put('-');
+		StreamSink sink(out);
+		big.to_decimal(sink, 0);
+	}
+	return out;
+}
+
+std::istream& operator>>(std::istream& in, BigInt& big)
+{
+	typedef std::istream::traits_type traits;
+	const std::istream::sentry sentry(in);
+	if (!sentry)
+		return in;
+	std::streambuf* const buffer = in.rdbuf();
+	traits::int_type c = buffer->sgetc();
+	const bool minus = traits::eq_int_type(c, traits::to_int_type('-'));
+	if (minus || traits::eq_int_type(c, traits::to_int_type('+')))
+		c = buffer->snextc();
+	// Whole blocks are converted as soon as they are read. Like a binary counter, two
+	// converted parts of the same length merge into one twice as long, so the digits
+	// are combined in balanced products: parts[i] holds the decimal_power_digits(
+	// STREAM_BLOCK_POWER + lengths[i]) digits that follow the ones of parts[i - 1]
+	const size_t block = decimal_power_digits(STREAM_BLOCK_POWER);
+	std::vector<BigInt> parts;
+	std::vector<size_t> lengths;
+	std::string digits;
+	bool any_digit = false;
+	for (; !traits::eq_int_type(c, traits::eof()) && is_decimal_digit(c); c = buffer->snextc())
+	{
+		digits.push_back(traits::to_char_type(c));
+		any_digit = true;
+		if (digits.size() < block)
+			continue;
+		BigInt low = BigInt::from_decimal(digits.data(), digits.data() + digits.size());
+		digits.clear();
+		size_t length = 0;
+		while (!lengths.empty() && lengths.back() == length)
+		{
+			BigInt high = std::move(parts.back());
+			parts.pop_back();
+			lengths.pop_back();
+			high *= decimal_power(STREAM_BLOCK_POWER + length);
+			high += low;
+			low = std::move(high);
+			++length;
+		}
+		parts.push_back(std::move(low));
+		lengths.push_back(length);
+	}
+	std::ios_base::iostate state = std::ios_base::goodbit;
+	if (traits::eq_int_type(c, traits::eof()))
+		state |= std::ios_base::eofbit;
+	if (!any_digit)
+	{
+		in.setstate(state | std::ios_base::failbit);
+		return in;
+	}
+	BigInt result;
+	if (!parts.empty())
+	{
+		result = std::move(parts[0]);
+		for (size_t i = 1; i < parts.size(); ++i)
+		{
+			result *= decimal_power(STREAM_BLOCK_POWER + lengths[i]);
+			result += parts[i];
+		}
+		if (!digits.empty())
+		{
+			result *= pow(BigInt(10), static_cast<int>(digits.size()));
+			result += BigInt::from_decimal(digits.data(), digits.data() + digits.size());
+		}
+	}
+	else
+	{
+		result = BigInt::from_decimal(digits.data(), digits.data() + digits.size());
+	}
+	if (minus && !result.is_zero())
+		result.set_sign(Sign::negative);
+	big = std::move(result);
+	in.setstate(state);
+	return in;
+}
+
+std::to_chars_result to_chars(char* first, char* last, const BigInt& value)
+{
+	BufferSink sink(first, last);
+	if (value.is_negative())
+		sink.write("-", 1);
+	value.to_decimal(sink, 0);
+	if (sink.overflow())
+		return { last, std::errc::value_too_large };
+	return { sink.next(), std::errc() };
+}
+
+std::from_chars_result from_chars(const char* first, const char* last, BigInt& value)
+{
+	const char* it = first;
+	const bool minus = it != last && *it == '-';
+	if (minus)
+		++it;
+	const char* const digits = it;
+	while (it != last && is_decimal_digit(*it))
+		++it;
+	if (it == digits)
+		return { first, std::errc::invalid_argument };
+	if (static_cast<size_t>(it - digits) <= DECIMAL_CHUNK_DIGITS)
+	{
+		// A single digit, stored in place of the previous value
+		BigInt::digit_t magnitude = 0;
+		for (const char* d = digits; d != it; ++d)
+			magnitude = magnitude * 10 + (*d - '0');
+		value.m_digits.assign(&magnitude, &magnitude + 1);
+		value.set_sign(minus && magnitude != 0 ? Sign::negative : Sign::positive);
+		return { it, std::errc() };
+	}
+	BigInt result = BigInt::from_decimal(digits, it);
+	if (minus && !result.is_zero())
+		result.set_sign(Sign::negative);
+	value = std::move(result);
+	return { it, std::errc() };
 }
 #pragma endregion
 
 #pragma region operators
-const BigInt& BigInt::operator*=(unsigned int num)
+const BigInt& BigInt::mul_digit(digit_t num)
 {
 	// This function perform the multiplication by a single digit (no sign check)
-	assert(num <= BIGINT_BASE);
-
 	// Multiplication by zero
 	if (num == 0)
 	{
@@ -126,18 +441,14 @@ const BigInt& BigInt::operator*=(unsigned int num)
 		return *this;
 	}
 	// General case
-	int carry = 0;
-	int product = 0;
-	for(int i = 0; i < num_digits(); ++i)
+	digit_t carry = 0;
+	for(size_t i = 0; i < num_digits(); ++i)
 	{
-		product = num * get_digit(i) + carry;
-		carry = product / BIGINT_BASE;
-		change_digit(i, product % BIGINT_BASE);
+		change_digit(i, mul_add(get_digit(i), num, 0, carry));
 	}
-	while(carry > 0)
+	if(carry > 0)
 	{
-		add_digit(carry % BIGINT_BASE);
-		carry /= BIGINT_BASE;
+		add_digit(carry);
 	}
 	return *this;
 }
@@ -145,57 +456,138 @@ const BigInt& BigInt::operator*=(unsigned int num)
 const BigInt& BigInt::operator*=(const BigInt& rhs)
 {
 	// Compute the sign of the result
-	m_sign = m_sign != rhs.m_sign ? Sign::negative : Sign::positive;
-	// Copy itself to avoid aliasing
-	BigInt self(*this);
-	BigInt sum(0);
-
-	for(int i = 0; i < rhs.num_digits(); ++i)
+	const Sign result_sign = sign() != rhs.sign() ? Sign::negative : Sign::positive;
+	// A single digit operand (a * 3) is multiplied in place
+	if (rhs.num_digits() == 1 && this != &rhs)
 	{
-		sum += self * static_cast<unsigned int>(rhs.get_digit(i));
-		self*=static_cast<unsigned int>(BIGINT_BASE);
+		mul_digit(rhs.get_digit(0));
+		set_sign(result_sign);
+		remove_leading_zeros();
+		return *this;
 	}
-	*this = sum;
+	// The product is computed in a separate buffer to avoid aliasing,
+	// the engine expects the longer operand first
+	const BigInt& longer = num_digits() >= rhs.num_digits() ? *this : rhs;
+	const BigInt& shorter = num_digits() >= rhs.num_digits() ? rhs : *this;
+	bigint_detail::LimbVector product(num_digits() + rhs.num_digits(), 0);
+	if (this == &rhs || m_digits == rhs.m_digits)
+		bigint_detail::sqr(product.data(), m_digits.data(), num_digits());
+	else
+		bigint_detail::mul(product.data(), longer.m_digits.data(), longer.num_digits(), shorter.m_digits.data(), shorter.num_digits());
+	m_digits.swap(product);
+	set_sign(result_sign);
+	remove_leading_zeros();
 	return *this;
 }
 
-BigInt operator*(unsigned int num, const BigInt& big)
+BigInt operator*(const BigInt& lhs, const BigInt& rhs)
 {
-	BigInt result(big);
-	result *= num;
+	BigInt result(lhs);
+	result *= rhs;
 	return result;
 }
 
-BigInt operator*(const BigInt& big, unsigned int num)
+BigInt operator*(BigInt&& lhs, const BigInt& rhs)
 {
-	BigInt result(big);
-	result *= num;
-	return result;
+	lhs *= rhs;
+	return std::move(lhs);
 }
 
-BigInt operator*(const BigInt& lhs, const BigInt& rhs)
+BigInt operator*(const BigInt& lhs, BigInt&& rhs)
 {
-	BigInt result(lhs);
-	result *= rhs;
-	return result;
+	rhs *= lhs;
+	return std::move(rhs);
+}
+
+BigInt operator*(BigInt&& lhs, BigInt&& rhs)
+{
+	lhs *= rhs;
+	return std::move(lhs);
+}
+
+const BigInt& BigInt::addmul(const BigInt& lhs, const BigInt& rhs)
+{
+	return accumulate_product(lhs, rhs, lhs.sign() != rhs.sign());
+}
+
+const BigInt& BigInt::submul(const BigInt& lhs, const BigInt& rhs)
+{
+	return accumulate_product(lhs, rhs, lhs.sign() == rhs.sign());
+}
+
+const BigInt& BigInt::accumulate_product(const BigInt& lhs, const BigInt& rhs, bool negative)
+{
+	const Sign product_sign = negative ? Sign::negative : Sign::positive;
+	const BigInt& longer = lhs.num_digits() >= rhs.num_digits() ? lhs : rhs;
+	const BigInt& shorter = lhs.num_digits() >= rhs.num_digits() ? rhs : lhs;
+	// The product is added row by row when the magnitudes add up and the schoolbook
+	// product is the one the engine would pick anyway
+	if ((is_zero() || sign() == product_sign) && this != &lhs && this != &rhs &&
+		shorter.num_digits() < thresholds().karatsuba_mul)
+	{
+		const size_t n = std::max(num_digits(), longer.num_digits() + shorter.num_digits()) + 1;
+		m_digits.resize(n, 0);
+		digit_t* const r = m_digits.data();
+		const digit_t* const a = longer.m_digits.data();
+		const size_t an = longer.num_digits();
+		for (size_t i = 0; i < shorter.num_digits(); ++i)
+		{
+			const digit_t carry = bigint_detail::addmul_1(r + i, a, an, shorter.get_digit(i));
+			bigint_detail::add_1(r + i + an, r + i + an, n - i - an, carry);
+		}
+		set_sign(product_sign);
+		remove_leading_zeros();
+		return *this;
+	}
+	BigInt product = lhs * rhs;
+	product.set_sign(product_sign);
+	product.remove_leading_zeros();
+	return *this += product;
 }
 
 BigInt BigInt::operator-() const
 {
 	BigInt result{ *this };
-	result.m_sign = result.m_sign == Sign::positive ? Sign::negative : Sign::positive;
+	result.set_sign(result.is_positive() ? Sign::negative : Sign::positive);
+	// Zero stays positive
+	result.remove_leading_zeros();
 	return result;
 }
 
+// Increment and decrement ripple a carry or a borrow through the magnitude in place
 const BigInt& BigInt::operator++()
 {
-	*this += BigInt(1);
+	digit_t* const digits = m_digits.data();
+	if (is_negative())
+	{
+		// -|x| + 1 = -(|x| - 1), the magnitude is at least one
+		bigint_detail::sub_1(digits, digits, num_digits(), 1);
+		remove_leading_zeros();
+	}
+	else if (bigint_detail::add_1(digits, digits, num_digits(), 1) > 0)
+	{
+		add_digit(1);
+	}
 	return *this;
 }
 
 const BigInt& BigInt::operator--()
 {
-	*this -= BigInt(1);
+	digit_t* const digits = m_digits.data();
+	if (is_zero())
+	{
+		change_digit(0, 1);
+		set_sign(Sign::negative);
+	}
+	else if (is_positive())
+	{
+		bigint_detail::sub_1(digits, digits, num_digits(), 1);
+		remove_leading_zeros();
+	}
+	else if (bigint_detail::add_1(digits, digits, num_digits(), 1) > 0)
+	{
+		add_digit(1);
+	}
 	return *this;
 }
 
@@ -213,38 +605,82 @@ BigInt BigInt::operator--(int)
 	return temp;
 }
 
-const BigInt& BigInt::operator+=(const BigInt& rhs)
+const BigInt& BigInt::add_signed(const BigInt& rhs, bool subtract)
 {
-	// If the operands do not share the same sign, subtract them
+	// Sign of the value that is actually added
+	const bool rhs_negative = rhs.is_negative() != subtract;
+	// If the operands do not share the same sign, subtract the magnitudes
 	//		A   +   B
-	//	If (-A) + (+B) => (-A) - (-B)
-	//  Or (+A) + (-B) => (+A) - (+B)
-	if(this->m_sign != rhs.m_sign)
+	//	If (-A) + (+B) => -(A - B) or +(B - A)
+	//  Or (+A) + (-B) => +(A - B) or -(B - A)
+	if (is_negative() != rhs_negative)
 	{
-		BigInt temp(rhs);
-		temp.m_sign = temp.is_positive() ? Sign::negative : Sign::positive;
-		return *this-=temp;
+		return subtract_magnitude(rhs, rhs_negative);
 	}
-	// The addition algorithm
-	// Get a pointer to smaller and larger BigInt operand
-	const auto max_n = std::max(this->num_digits(), rhs.num_digits());
+	// The addition algorithm, the sign does not change
+	const size_t rhs_n = rhs.num_digits();
+	const size_t max_n = std::max(this->num_digits(), rhs_n);
+	m_digits.resize(max_n, 0);
 	// Perform the operation
-	int carry = 0;
-	int sum = 0;
-		for (auto i = 0; i < max_n; ++i)
-		{
-			sum = get_digit(i) + rhs.get_digit(i) + carry;
-			carry = sum / BIGINT_BASE;
-			if (i < num_digits())
-				change_digit(i, sum % BIGINT_BASE);
-			else
-				add_digit(sum % BIGINT_BASE);
-		}
-		if (carry > 0)
-		{
-			add_digit(1);
-		}
+	digit_t carry = 0;
+	size_t i = 0;
+	for (; i < rhs_n; ++i)
+	{
+		change_digit(i, add_with_carry(get_digit(i), rhs.get_digit(i), carry));
+	}
+	// Propagate the carry through the remaining digits of *this
+	for (; carry > 0 && i < max_n; ++i)
+	{
+		change_digit(i, add_with_carry(get_digit(i), 0, carry));
+	}
+	if (carry > 0)
+	{
+		add_digit(1);
+	}
+	return *this;
+}
+
+const BigInt& BigInt::subtract_magnitude(const BigInt& rhs, bool rhs_negative)
+{
+	if (compare_magnitude(rhs) < 0)
+	{
+		// |rhs| - |*this| computed in place, the result takes the sign of rhs
+		const size_t n = num_digits();
+		m_digits.resize(rhs.num_digits(), 0);
+		digit_t* const digits = m_digits.data();
+		const digit_t borrow = bigint_detail::sub_n(digits, rhs.m_digits.data(), digits, n);
+		bigint_detail::sub_1(digits + n, rhs.m_digits.data() + n, rhs.num_digits() - n, borrow);
+		set_sign(rhs_negative ? Sign::negative : Sign::positive);
+		remove_leading_zeros();
 		return *this;
+	}
+	// Now we are in the case that *this is greater than rhs and we can subtract from it
+	const size_t rhs_n = rhs.num_digits();
+	digit_t borrow = 0;
+	size_t i = 0;
+	for(; i < rhs_n; ++i)
+	{
+		change_digit(i, sub_with_borrow(get_digit(i), rhs.get_digit(i), borrow));
+	}
+	// Propagate the borrow through the remaining digits of *this
+	for(; borrow > 0 && i < num_digits(); ++i)
+	{
+		change_digit(i, sub_with_borrow(get_digit(i), 0, borrow));
+	}
+	remove_leading_zeros();
+	return *this;
+}
+
+int BigInt::compare_magnitude(const BigInt& rhs) const
+{
+	if (num_digits() != rhs.num_digits())
+		return num_digits() < rhs.num_digits() ? -1 : 1;
+	return bigint_detail::cmp_n(m_digits.data(), rhs.m_digits.data(), num_digits());
+}
+
+const BigInt& BigInt::operator+=(const BigInt& rhs)
+{
+	return add_signed(rhs, false);
 }
 
 BigInt operator+(const BigInt& lhs, const BigInt& rhs)
@@ -254,47 +690,33 @@ BigInt operator+(const BigInt& lhs, const BigInt& rhs)
 	return result;
 }
 
-const BigInt& BigInt::operator-=(const BigInt& rhs)
+BigInt operator+(BigInt&& lhs, const BigInt& rhs)
 {
-	// If they have different sign transform it in an addition by multiplying the rhs by -1
-	//		A   -   B
-	//	If (-A) - (+B) => (-A) + (-B)
-	//  Or (+A) - (-B) => (+A) + (+B)
-	if(this->m_sign != rhs.m_sign)
-	{
-		BigInt temp(rhs);
-		temp.m_sign = temp.is_positive() ? Sign::negative : Sign::positive;
-		return *this += temp;
-	}
-	// Handle the subtraction algorithm
-	// "swap" the operands to set the greater on the left side
-	if(is_positive() && (*this) < rhs || is_negative() && (*this) > rhs)
-	{
-		// switch operand order
-		*this = rhs - *this;
-		// switch sign
-		m_sign = is_positive() ? Sign::negative : Sign::positive;
-		return *this;
-	}
-	// Now we are in the case that *this is greater than rhs and we can subtract from it
-	int borrow = 0;
-	int diff = 0;
-	for(int i = 0; i < num_digits(); ++i)
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+BigInt operator+(const BigInt& lhs, BigInt&& rhs)
+{
+	rhs += lhs;
+	return std::move(rhs);
+}
+
+BigInt operator+(BigInt&& lhs, BigInt&& rhs)
+{
+	// Keep the operand that can hold the sum without growing
+	if (rhs.num_digits() > lhs.num_digits())
 	{
-		diff = get_digit(i) - rhs.get_digit(i) - borrow;
-		if(diff < 0)
-		{
-			diff += BIGINT_BASE;
-			borrow = 1;
-		}
-		else
-		{
-			borrow = 0;
-		}
-		change_digit(i, diff);
+		rhs += lhs;
+		return std::move(rhs);
 	}
-	remove_leading_zeros();
-	return *this;
+	lhs += rhs;
+	return std::move(lhs);
+}
+
+const BigInt& BigInt::operator-=(const BigInt& rhs)
+{
+	return add_signed(rhs, true);
 }
 
 BigInt operator-(const BigInt& lhs, const BigInt& rhs)
@@ -304,192 +726,343 @@ BigInt operator-(const BigInt& lhs, const BigInt& rhs)
 	return result;
 }
 
-void iterative_subtraction_division(const BigInt& lhs, const BigInt& rhs, BigInt& out_quotient, BigInt& out_reminder)
+BigInt operator-(BigInt&& lhs, const BigInt& rhs)
 {
-	if (rhs == 0)
-	{
-		throw std::runtime_error("Math error: Attempted to divide by Zero\n");
-	}
+	lhs -= rhs;
+	return std::move(lhs);
+}
 
-	// Compute the sign
-	const Sign result_sign = lhs.m_sign != rhs.m_sign ? Sign::negative : Sign::positive;
+BigInt operator-(const BigInt& lhs, BigInt&& rhs)
+{
+	// lhs - rhs = -(rhs - lhs)
+	rhs -= lhs;
+	rhs.set_sign(rhs.is_positive() ? Sign::negative : Sign::positive);
+	rhs.remove_leading_zeros();
+	return std::move(rhs);
+}
 
-	BigInt rhsTemp(rhs);
-	rhsTemp.m_sign = Sign::positive;
-	// Count how many times rhsTemp is contained in *this
-	out_quotient = 0;
-	out_reminder = lhs;
-	// Simplify the computation striping out the sign
-	out_reminder.m_sign = Sign::positive;
-	while (out_reminder >= rhsTemp)
-	{
-		out_reminder -= rhsTemp;
-		out_quotient += 1;
-	}
-	// Restore the correct sign
-	out_quotient.m_sign = result_sign;
+BigInt operator-(BigInt&& lhs, BigInt&& rhs)
+{
+	lhs -= rhs;
+	return std::move(lhs);
 }
 
-const BigInt& BigInt::operator/=(const BigInt& rhs)
+std::pair<BigInt, BigInt> divmod(const BigInt& lhs, const BigInt& rhs)
 {
-/*	BigInt quotient;
-	BigInt reminder;
-	iterative_subtraction_division(*this, rhs, quotient, reminder);
-	std::swap(*this, quotient);
-	return *this;*/
-	const Sign result_sign = this->m_sign != rhs.m_sign ? Sign::negative : Sign::positive;
-	BigInt temp_rhs(rhs);
-	temp_rhs.m_sign = Sign::positive;
-	BigInt temp(*this);
-	temp.m_sign = Sign::positive;
-	BigInt dividend = 0;
-	BigInt result = 0;
+	if (rhs == 0)
+	{
+		throw std::runtime_error("Math error: Attempted to divide by Zero\n");
+	}
+	// Both results take the sign of the product of the operand signs
+	const Sign result_sign = lhs.sign() != rhs.sign() ? Sign::negative : Sign::positive;
 	BigInt quotient;
-	BigInt reminder = 0;
-	while(temp.m_digits.size() > 0)
+	BigInt remainder;
+	if (lhs.compare_magnitude(rhs) < 0)
+	{
+		remainder = lhs;
+	}
+	else
 	{
-		dividend *= BIGINT_BASE;
-		dividend += temp.m_digits.back();
-		result *= BIGINT_BASE;
-		if (dividend >= temp_rhs)
+		// Normalize the divisor so that its most significant bit is set, the dividend
+		// gets an extra digit so that its top digits are smaller than the divisor
+		const size_t dn = rhs.num_digits();
+		const size_t un = lhs.num_digits() + 1;
+		const unsigned int shift = bigint_detail::count_leading_zeros(rhs.m_digits.back());
+		bigint_detail::LimbVector divisor(rhs.m_digits);
+		bigint_detail::LimbVector dividend(lhs.m_digits);
+		dividend.push_back(0);
+		if (shift > 0)
 		{
-			iterative_subtraction_division(dividend, temp_rhs, quotient, reminder);
-			result += quotient;
-			dividend = reminder;
+			bigint_detail::lshift(divisor.data(), divisor.data(), dn, shift);
+			bigint_detail::lshift(dividend.data(), dividend.data(), un, shift);
 		}
-		temp.m_digits.pop_back();
+		quotient.m_digits.resize(un - dn);
+		bigint_detail::div_qr(quotient.m_digits.data(), dividend.data(), un, divisor.data(), dn);
+		// The remainder is left in the low digits of the dividend
+		dividend.resize(dn);
+		if (shift > 0)
+		{
+			bigint_detail::rshift(dividend.data(), dividend.data(), dn, shift);
+		}
+		remainder.m_digits.swap(dividend);
 	}
-	std::swap(*this, result);
-	this->m_sign = result_sign;
+	quotient.set_sign(result_sign);
+	quotient.remove_leading_zeros();
+	remainder.set_sign(result_sign);
+	remainder.remove_leading_zeros();
+	return { std::move(quotient), std::move(remainder) };
+}
+
+const BigInt& BigInt::operator/=(const BigInt& rhs)
+{
+	*this = std::move(divmod(*this, rhs).first);
 	return *this;
 }
 
 BigInt operator/(const BigInt& lhs, const BigInt& rhs)
 {
-	BigInt result(lhs);
-	result /= rhs;
-	return result;
+	return std::move(divmod(lhs, rhs).first);
 }
 
 const BigInt& BigInt::operator%=(const BigInt& rhs)
 {
-	const Sign result_sign = this->m_sign != rhs.m_sign ? Sign::negative : Sign::positive;
-	BigInt temp_rhs(rhs);
-	temp_rhs.m_sign = Sign::positive;
-	BigInt temp(*this);
-	temp.m_sign = Sign::positive;
-	BigInt dividend = 0;
-	BigInt result = 0;
-	BigInt quotient;
-	BigInt reminder = 0;
-	while (temp.m_digits.size() > 0)
-	{
-		dividend *= BIGINT_BASE;
-		dividend += temp.m_digits.back();
-		result *= BIGINT_BASE;
-		if (dividend >= temp_rhs)
-		{
-			iterative_subtraction_division(dividend, temp_rhs, quotient, reminder);
-			result += quotient;
-			dividend = reminder;
-		}
-		temp.m_digits.pop_back();
-	}
-	std::swap(*this, dividend);
-	this->m_sign = result_sign;
-	remove_leading_zeros();
+	*this = std::move(divmod(*this, rhs).second);
 	return *this;
 }
 
 BigInt operator%(const BigInt& lhs, const BigInt& rhs)
 {
-	BigInt result(lhs);
-	result %= rhs;
-	return result;
+	return std::move(divmod(lhs, rhs).second);
 }
 
 BigInt pow(const BigInt& base, const BigInt& exponent)
 {
-	if (exponent < 0)
+	if (exponent.is_negative())
 	{
-		throw std::exception("Negative exponents are not supported for BigInt types.");
+		throw std::domain_error("Negative exponents are not supported for BigInt types.");
 	}
-	if (exponent == 0)
+	if (exponent.is_zero())
 	{
 		return 1;
 	}
-	// Continue with the "normal" cases
-	BigInt result{ base };
-	for (BigInt i = 0; i < exponent; ++i)
+	if (base.is_zero())
 	{
-		result *= base;
+		return 0;
 	}
+	// The power is negative for a negative base and an odd exponent
+	const Sign result_sign = base.is_negative() && (exponent.get_digit(0) & 1) ? Sign::negative : Sign::positive;
+	// |base| = odd * 2^shift: the power of two factor becomes a single shift of the result
+	size_t zero_digits = 0;
+	while (base.get_digit(zero_digits) == 0)
+		++zero_digits;
+	const size_t shift = zero_digits * BIGINT_DIGIT_BITS + bigint_detail::count_trailing_zeros(base.get_digit(zero_digits));
+	BigInt odd = base.is_negative() ? -base : base;
+	odd >>= shift;
+	const bool odd_is_one = odd.num_digits() == 1 && odd.get_digit(0) == 1;
+	BigInt result = 1;
+	if (!odd_is_one || shift > 0)
+	{
+		// Any exponent of a digit or more gives a result of more than 2^64 bits
+		const uint64_t e = exponent.get_digit(0);
+		if (exponent.num_digits() > 1 || (shift > 0 && e > SIZE_MAX / shift))
+		{
+			throw std::length_error("BigInt power is too large to be represented.");
+		}
+		if (!odd_is_one)
+		{
+			const auto square = [](BigInt& x)
+			{
+				x *= x;
+			};
+			const auto multiply = [](BigInt& x, const BigInt& y)
+			{
+				x *= y;
+			};
+			result = bigint_detail::window_power(BigInt(1), odd, &e, 1, square, multiply);
+		}
+		result <<= shift * e;
+	}
+	result.set_sign(result_sign);
 	return result;
 }
 
 BigInt pow(const BigInt& base, int exponent)
 {
-	if (exponent < 0)
-	{
-		throw std::exception("Negative exponents are not supported for BigInt types.");
-	}
-	if (exponent == 0)
-	{
-		return 1;
-	}
-	// Continue with the "normal" cases
-	BigInt result{ base };
-	for (BigInt i = 1; i < exponent; ++i)
-	{
-		result *= base;
-	}
-	return result;
+	return pow(base, BigInt(exponent));
 }
 
 #pragma endregion 
 
+#pragma region tuning
+namespace
+{
+	BigIntThresholds g_thresholds;
+	std::atomic<BigIntThreadPool*> g_thread_pool(nullptr);
+}
+
+const BigIntThresholds& BigInt::thresholds()
+{
+	return g_thresholds;
+}
+
+void BigInt::set_thresholds(const BigIntThresholds& thresholds)
+{
+	g_thresholds = thresholds;
+	// Below these sizes the splitting algorithms would not terminate
+	g_thresholds.karatsuba_mul = std::max<size_t>(g_thresholds.karatsuba_mul, 2);
+	g_thresholds.karatsuba_sqr = std::max<size_t>(g_thresholds.karatsuba_sqr, 2);
+	g_thresholds.toom3_mul = std::max<size_t>(g_thresholds.toom3_mul, 5);
+	g_thresholds.dc_div = std::max<size_t>(g_thresholds.dc_div, 4);
+	g_thresholds.dc_radix = std::max<size_t>(g_thresholds.dc_radix, 2);
+	g_thresholds.hgcd = std::max<size_t>(g_thresholds.hgcd, 4);
+	g_thresholds.parallel_mul = std::max<size_t>(g_thresholds.parallel_mul, 2);
+}
+
+BigIntThreadPool* BigInt::thread_pool()
+{
+	return g_thread_pool.load(std::memory_order_acquire);
+}
+
+BigIntThreadPool* BigInt::set_thread_pool(BigIntThreadPool* pool)
+{
+	return g_thread_pool.exchange(pool, std::memory_order_acq_rel);
+}
+#pragma endregion
+
+#pragma region memory
+namespace
+{
+	thread_local std::pmr::memory_resource* t_memory_resource = nullptr;
+}
+
+std::pmr::memory_resource* bigint_detail::current_limb_resource()
+{
+	return t_memory_resource != nullptr ? t_memory_resource : std::pmr::get_default_resource();
+}
+
+std::pmr::memory_resource* BigInt::memory_resource()
+{
+	return bigint_detail::current_limb_resource();
+}
+
+std::pmr::memory_resource* BigInt::set_memory_resource(std::pmr::memory_resource* resource)
+{
+	std::pmr::memory_resource* const previous = bigint_detail::current_limb_resource();
+	t_memory_resource = resource;
+	return previous;
+}
+#pragma endregion
+
 #pragma region bitwise-operators
 
-void BigInt::perform_bitwise(const BigInt& rhs, std::function<uint8_t(uint8_t, uint8_t)> bw_operator)
+namespace
 {
-	const auto size_r = rhs.m_digits.size();
-	const auto size_l = m_digits.size();
-	for (int i = 0; i < std::max(size_r, size_l); ++i)
+	// One pass of a bitwise operation on the two's complements of signed magnitudes.
+	// The complements are taken on the fly: the two's complement of -m is ~m + 1, and
+	// the carry of the + 1 only runs through the low zero limbs. A negative result
+	// (r_negative) is turned back into its magnitude the same way. r may alias a or b
+	template <typename Operation>
+	void twos_complement_bitwise(uint64_t* r, size_t n, const uint64_t* a, size_t an, bool a_negative,
+		const uint64_t* b, size_t bn, bool b_negative, bool r_negative, Operation operation)
 	{
-		const auto digit_r = i < size_r ? rhs.get_digit(i) : 0;
-		const auto digit_l = i < size_l ? get_digit(i) : 0;
-		if (i < size_l)
-		{
-			m_digits[i] = bw_operator(digit_l, digit_r);
-		}
-		else
+		const uint64_t a_mask = 0 - uint64_t(a_negative);
+		const uint64_t b_mask = 0 - uint64_t(b_negative);
+		const uint64_t r_mask = 0 - uint64_t(r_negative);
+		uint64_t a_carry = a_negative;
+		uint64_t b_carry = b_negative;
+		uint64_t r_carry = r_negative;
+		for (size_t i = 0; i < n; ++i)
 		{
-			m_digits.push_back(bw_operator(digit_l, digit_r));
+			const uint64_t x = ((i < an ? a[i] : 0) ^ a_mask) + a_carry;
+			a_carry &= x == 0;
+			const uint64_t y = ((i < bn ? b[i] : 0) ^ b_mask) + b_carry;
+			b_carry &= y == 0;
+			const uint64_t z = (operation(x, y) ^ r_mask) + r_carry;
+			r_carry &= z == 0;
+			r[i] = z;
 		}
 	}
-	remove_leading_zeros();
 }
 
-const BigInt& BigInt::operator&=(const BigInt& rhs)
+void BigInt::perform_bitwise(const BigInt& rhs, Bitwise operation)
 {
-	/*const auto size_r = rhs.m_digits.size();
-	const auto size_l = m_digits.size();
-	for(int i = 0; i < std::max(size_r, size_l); ++i)
+	const size_t an = num_digits();
+	const size_t bn = rhs.num_digits();
+	const bool a_negative = is_negative();
+	const bool b_negative = rhs.is_negative();
+	if (!a_negative && !b_negative)
 	{
-		const auto digit_r = i < size_r ? rhs.get_digit(i) : 0;
-		const auto digit_l = i < size_l ? get_digit(i) : 0;
-		if(i < size_l)
+		// Magnitudes only: the vector kernels on the digits both operands have, the
+		// result is sized once before they run
+		const size_t common = std::min(an, bn);
+		if (operation == Bitwise::and_op)
 		{
-			m_digits[i] = digit_l & digit_r;
+			m_digits.resize(common);
 		}
-		else
+		else if (bn > common)
 		{
-			m_digits.push_back(digit_l & digit_r);
+			m_digits.resize(bn);
+			std::copy(rhs.m_digits.begin() + common, rhs.m_digits.end(), m_digits.begin() + common);
 		}
+		const auto kernel = operation == Bitwise::and_op ? bigint_detail::and_n : operation == Bitwise::or_op ? bigint_detail::or_n : bigint_detail::xor_n;
+		kernel(m_digits.data(), m_digits.data(), rhs.m_digits.data(), common);
+		remove_leading_zeros();
+		return;
 	}
+
+	// Digits of the result: a non negative operand bounds x & y, a negative one bounds
+	// the magnitude of x | y, the others take a digit more than the longer operand
+	bool r_negative;
+	size_t n;
+	switch (operation)
+	{
+	case Bitwise::and_op:
+		r_negative = a_negative && b_negative;
+		n = r_negative ? std::max(an, bn) + 1 : a_negative ? bn : b_negative ? an : std::min(an, bn);
+		break;
+	case Bitwise::or_op:
+		r_negative = true;
+		n = a_negative && b_negative ? std::min(an, bn) : a_negative ? an : bn;
+		break;
+	default:
+		r_negative = a_negative != b_negative;
+		n = std::max(an, bn) + 1;
+		break;
+	}
+	if (n > an)
+		m_digits.resize(n);
+	// Read after the resize, rhs may be *this
+	const digit_t* const b = rhs.m_digits.data();
+	digit_t* const r = m_digits.data();
+	switch (operation)
+	{
+	case Bitwise::and_op:
+		twos_complement_bitwise(r, n, r, an, a_negative, b, bn, b_negative, r_negative, [](digit_t x, digit_t y) { return x & y; });
+		break;
+	case Bitwise::or_op:
+		twos_complement_bitwise(r, n, r, an, a_negative, b, bn, b_negative, r_negative, [](digit_t x, digit_t y) { return x | y; });
+		break;
+	default:
+		twos_complement_bitwise(r, n, r, an, a_negative, b, bn, b_negative, r_negative, [](digit_t x, digit_t y) { return x ^ y; });
+		break;
+	}
+	m_digits.resize(n);
+	set_sign(r_negative ? Sign::negative : Sign::positive);
 	remove_leading_zeros();
-	return *this;*/
-	perform_bitwise(rhs, std::bit_and<uint8_t>());
+}
+
+void BigInt::complement()
+{
+	// ~x == -(x + 1): one carry or borrow pass on the magnitude, and the sign flips
+	if (is_negative())
+	{
+		bigint_detail::sub_1(m_digits.data(), m_digits.data(), num_digits(), 1);
+		set_sign(Sign::positive);
+		remove_leading_zeros();
+		return;
+	}
+	const digit_t carry = bigint_detail::add_1(m_digits.data(), m_digits.data(), num_digits(), 1);
+	if (carry > 0)
+		add_digit(carry);
+	set_sign(Sign::negative);
+}
+
+BigInt BigInt::operator~() const &
+{
+	BigInt result(*this);
+	result.complement();
+	return result;
+}
+
+BigInt BigInt::operator~() &&
+{
+	complement();
+	return std::move(*this);
+}
+
+const BigInt& BigInt::operator&=(const BigInt& rhs)
+{
+	perform_bitwise(rhs, Bitwise::and_op);
 	return *this;
 }
 
@@ -500,9 +1073,27 @@ BigInt operator&(const BigInt& lhs, const BigInt& rhs)
 	return result;
 }
 
+BigInt operator&(BigInt&& lhs, const BigInt& rhs)
+{
+	lhs &= rhs;
+	return std::move(lhs);
+}
+
+BigInt operator&(const BigInt& lhs, BigInt&& rhs)
+{
+	rhs &= lhs;
+	return std::move(rhs);
+}
+
+BigInt operator&(BigInt&& lhs, BigInt&& rhs)
+{
+	lhs &= rhs;
+	return std::move(lhs);
+}
+
 const BigInt& BigInt::operator|=(const BigInt& rhs)
 {
-	perform_bitwise(rhs, std::bit_or<uint8_t>());
+	perform_bitwise(rhs, Bitwise::or_op);
 	return *this;
 }
 
@@ -513,6 +1104,24 @@ BigInt operator|(const BigInt& lhs, const BigInt& rhs)
 	return result;
 }
 
+BigInt operator|(BigInt&& lhs, const BigInt& rhs)
+{
+	lhs |= rhs;
+	return std::move(lhs);
+}
+
+BigInt operator|(const BigInt& lhs, BigInt&& rhs)
+{
+	rhs |= lhs;
+	return std::move(rhs);
+}
+
+BigInt operator|(BigInt&& lhs, BigInt&& rhs)
+{
+	lhs |= rhs;
+	return std::move(lhs);
+}
+
 BigInt operator^(const BigInt& lhs, const BigInt& rhs)
 {
 	BigInt result(lhs);
@@ -520,61 +1129,91 @@ BigInt operator^(const BigInt& lhs, const BigInt& rhs)
 	return result;
 }
 
+BigInt operator^(BigInt&& lhs, const BigInt& rhs)
+{
+	lhs ^= rhs;
+	return std::move(lhs);
+}
+
+BigInt operator^(const BigInt& lhs, BigInt&& rhs)
+{
+	rhs ^= lhs;
+	return std::move(rhs);
+}
+
+BigInt operator^(BigInt&& lhs, BigInt&& rhs)
+{
+	lhs ^= rhs;
+	return std::move(lhs);
+}
+
 const BigInt& BigInt::operator^=(const BigInt& rhs)
 {
-	perform_bitwise(rhs, std::bit_xor<uint8_t>());
+	perform_bitwise(rhs, Bitwise::xor_op);
 	return *this;
 }
 
 BigInt& BigInt::operator<<=(std::size_t pos)
 {
-	const size_t digit_bits = 8 * sizeof(digit_t);
-	const size_t elements_to_insert = pos / digit_bits;
-	// The shift is now decreased with the remaining bits to shift
-	pos %= digit_bits;
-	digit_t extra = 0;
-	const size_t pos_right = digit_bits - pos;
-	for (int i = 0; i < m_digits.size(); ++i)
-	{
-		const digit_t d_i = get_digit(i);
-		m_digits[i] = (d_i << pos) | extra;
-		extra = d_i >> pos_right;
-	}
-	if(extra > 0)
+	if (is_zero())
 	{
-		m_digits.push_back(extra);
+		return *this;
 	}
-	// Insert shifted zeroes
-	std::vector<digit_t> zeroes(elements_to_insert, 0);
-	m_digits.insert(m_digits.begin(), zeroes.begin(), zeroes.end());
+	const size_t words = pos / BIGINT_DIGIT_BITS;
+	const unsigned int bits = pos % BIGINT_DIGIT_BITS;
+	const size_t n = num_digits();
+	// Sized once: the digits move up by words, plus one digit for the bits shifted out
+	m_digits.resize(n + words + (bits > 0 ? 1 : 0), 0);
+	digit_t* const digits = m_digits.data();
+	// A full word shift is undefined behaviour, so the funnel shift only runs when needed
+	if (bits > 0)
+		digits[n + words] = bigint_detail::lshift(digits + words, digits, n, bits);
+	else
+		std::copy_backward(digits, digits + n, digits + n + words);
+	std::fill(digits, digits + words, 0);
 	remove_leading_zeros();
 	return *this;
 }
 
 BigInt BigInt::operator<<(std::size_t pos) const
 {
-	BigInt result(*this);
+	// Reserved for the shifted value, so <<= does not reallocate the copy
+	BigInt result;
+	result.m_digits.reserve(num_digits() + pos / BIGINT_DIGIT_BITS + 1);
+	result.m_digits.assign(m_digits.begin(), m_digits.end());
+	result.set_sign(sign());
 	result <<= pos;
 	return result;
 }
 
 BigInt& BigInt::operator>>=(std::size_t pos)
 {
-	const size_t digit_bits = 8 * sizeof(digit_t);
-	const size_t elements_to_remove = pos / digit_bits;
-	// All those digits will be lost
-	m_digits.erase(m_digits.begin(), m_digits.begin() + elements_to_remove);
-	// The shift is now decreased with the remaining bits to shift
-	pos %= digit_bits;	
-	digit_t extra = 0;
-	const size_t pos_left = digit_bits - pos;
-	for (int i = m_digits.size() - 1; i >= 0; --i)
+	const size_t words = pos / BIGINT_DIGIT_BITS;
+	const bool negative = is_negative();
+	// Shifting out every digit leaves zero, or -1 for the negative values
+	if (words >= num_digits())
 	{
-		const digit_t d_i = get_digit(i);
-		m_digits[i] = (d_i >> pos) | extra;
-		extra = d_i << pos_left;
+		*this = BigInt(negative ? -1 : 0);
+		return *this;
 	}
+	// floor(-m / 2^pos) = -ceil(m / 2^pos): the magnitude of a negative value rounds
+	// up when any set bit is shifted out
+	bool round_up = false;
+	for (size_t i = 0; negative && !round_up && i < words; ++i)
+		round_up = m_digits[i] != 0;
+	const unsigned int bits = pos % BIGINT_DIGIT_BITS;
+	const size_t n = num_digits() - words;
+	digit_t* const digits = m_digits.data();
+	// The kept digits move down in a single pass, then the vector shrinks once
+	if (bits > 0)
+		round_up |= bigint_detail::rshift(digits, digits + words, n, bits) != 0 && negative;
+	else
+		std::copy(digits + words, digits + words + n, digits);
+	m_digits.resize(n);
 	remove_leading_zeros();
+	// A magnitude shifted down to zero is positive again, and 0 - 1 is the result
+	if (round_up)
+		--*this;
 	return *this;
 }
 
@@ -589,9 +1228,21 @@ BigInt BigInt::operator>>(std::size_t pos) const
 
 #pragma region comparisons
 
+// Signs first, then the sizes of the magnitudes and their digits from the most
+// significant one down (vectorized, see BigIntBitwise.cpp)
+int compare(const BigInt& lhs, const BigInt& rhs)
+{
+	if (lhs.sign() != rhs.sign())
+		return lhs.is_negative() ? -1 : 1;
+	const int magnitude = lhs.compare_magnitude(rhs);
+	return lhs.is_negative() ? -magnitude : magnitude;
+}
+
+// Same answer as compare(lhs, rhs) == 0, but equality needs no ordering: the
+// digits are compared as a block
 bool operator==(const BigInt& lhs, const BigInt& rhs)
 {
-	return (lhs.m_sign == rhs.m_sign && lhs.m_digits == rhs.m_digits);
+	return (lhs.sign() == rhs.sign() && lhs.m_digits == rhs.m_digits);
 }
 
 bool operator!=(const BigInt& lhs, const BigInt& rhs)
@@ -601,77 +1252,35 @@ bool operator!=(const BigInt& lhs, const BigInt& rhs)
 
 bool operator<(const BigInt& lhs, const BigInt& rhs)
 {
-	if (lhs.is_negative())
-	{
-		if (rhs.is_positive())
-			return true;
-		if (lhs.num_digits() < rhs.num_digits())
-			return false;
-		else if (lhs.num_digits() == rhs.num_digits())
-			return lhs.m_digits > rhs.m_digits;
-		else
-			return true;
-	}
-	else
-	{
-		if (rhs.is_negative())
-			return false;
-		if (lhs.num_digits() < rhs.num_digits())
-			return true;
-		else if (lhs.num_digits() == rhs.num_digits())
-			return lhs.m_digits < rhs.m_digits;
-		else
-			return false;
-	}
+	return compare(lhs, rhs) < 0;
 }
 
 bool operator>(const BigInt& lhs, const BigInt& rhs)
 {
-	if (lhs.is_negative())
-	{
-		if (rhs.is_positive())
-			return false;
-		if (lhs.num_digits() < rhs.num_digits())
-			return true;
-		else if (lhs.num_digits() == rhs.num_digits())
-			return lhs.m_digits < rhs.m_digits;
-		else
-			return false;
-	}
-	else
-	{
-		if (rhs.is_negative())
-			return true;
-		if (lhs.num_digits() < rhs.num_digits())
-			return false;
-		else if (lhs.num_digits() == rhs.num_digits())
-			return lhs.m_digits > rhs.m_digits;
-		else
-			return true;
-	}
+	return compare(lhs, rhs) > 0;
 }
 
 bool operator<=(const BigInt& lhs, const BigInt& rhs)
 {
-	return !(lhs > rhs);
+	return compare(lhs, rhs) <= 0;
 }
 
 bool operator>=(const BigInt& lhs, const BigInt& rhs)
 {
-	return !(lhs < rhs);
+	return compare(lhs, rhs) >= 0;
 }
 #pragma endregion
 
 const BigInt& BigInt::remove_leading_zeros()
 {
-	int elements_to_remove = 0;
-	for (int i = static_cast<int>(num_digits()) - 1; i > 0 && get_digit(i) == 0; --i)
+	size_t elements_to_remove = 0;
+	for (size_t i = num_digits() - 1; i > 0 && get_digit(i) == 0; --i)
 		elements_to_remove++;
 	m_digits.erase(m_digits.end()-elements_to_remove, m_digits.end());
 
 	// If the result is zero force it to be positive
 	if (num_digits() == 1 && get_digit(0) == 0)
-		m_sign = Sign::positive;
+		set_sign(Sign::positive);
 	
 	return *this;
 }
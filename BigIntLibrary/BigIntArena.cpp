@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <thread>
+
+#include "include/BigInt.h"
+#include "include/BigIntArena.h"
+
+namespace
+{
+	char* align_up(char* p, size_t alignment)
+	{
+		const uintptr_t value = reinterpret_cast<uintptr_t>(p);
+		return p + ((alignment - value % alignment) % alignment);
+	}
+
+	char* chunk_begin(void* chunk, size_t header)
+	{
+		return static_cast<char*>(chunk) + header;
+	}
+
+	// Guards the allocations of an arena, see BigIntArena::m_busy
+	class SpinLock
+	{
+	public:
+		explicit SpinLock(std::atomic_flag& busy) : m_busy(busy)
+		{
+			while (m_busy.test_and_set(std::memory_order_acquire))
+				std::this_thread::yield();
+		}
+		~SpinLock()
+		{
+			m_busy.clear(std::memory_order_release);
+		}
+		SpinLock(const SpinLock&) = delete;
+		SpinLock& operator=(const SpinLock&) = delete;
+
+	private:
+		std::atomic_flag& m_busy;
+	};
+}
+
+#pragma region arena
+BigIntArena::BigIntArena(size_t chunk_bytes, std::pmr::memory_resource* upstream)
+	: m_upstream(upstream), m_chunk_bytes(chunk_bytes), m_first(nullptr), m_current(nullptr),
+	m_position(nullptr), m_end(nullptr), m_allocated(0)
+{
+
+}
+
+BigIntArena::~BigIntArena()
+{
+	for (Chunk* chunk = m_first; chunk != nullptr;)
+	{
+		Chunk* const next = chunk->next;
+		m_upstream->deallocate(chunk, chunk->size, alignof(std::max_align_t));
+		chunk = next;
+	}
+}
+
+void BigIntArena::reset()
+{
+	m_current = m_first;
+	m_position = m_first != nullptr ? chunk_begin(m_first, sizeof(Chunk)) : nullptr;
+	m_end = m_first != nullptr ? chunk_begin(m_first, m_first->size) : nullptr;
+	m_allocated = 0;
+}
+
+BigIntArena& BigIntArena::thread_local_instance()
+{
+	thread_local BigIntArena arena;
+	return arena;
+}
+
+void* BigIntArena::do_allocate(size_t bytes, size_t alignment)
+{
+	const SpinLock lock(m_busy);
+	char* p = m_position != nullptr ? align_up(m_position, alignment) : nullptr;
+	if (p == nullptr || bytes > static_cast<size_t>(m_end - p))
+	{
+		next_chunk(bytes, alignment);
+		p = align_up(m_position, alignment);
+	}
+	m_position = p + bytes;
+	m_allocated += bytes;
+	return p;
+}
+
+void BigIntArena::do_deallocate(void* p, size_t bytes, size_t)
+{
+	const SpinLock lock(m_busy);
+	// Only the most recent allocation can be given back, the rest waits for reset()
+	if (static_cast<char*>(p) + bytes == m_position)
+	{
+		m_position = static_cast<char*>(p);
+		m_allocated -= bytes;
+	}
+}
+
+bool BigIntArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+void BigIntArena::next_chunk(size_t bytes, size_t alignment)
+{
+	const size_t needed = sizeof(Chunk) + bytes + alignment;
+	Chunk* const next = m_current != nullptr ? m_current->next : m_first;
+	Chunk* chunk;
+	if (next != nullptr && next->size >= needed)
+	{
+		chunk = next;
+	}
+	else
+	{
+		// Link a new chunk in front of the free ones
+		const size_t size = std::max(m_chunk_bytes, needed);
+		chunk = static_cast<Chunk*>(m_upstream->allocate(size, alignof(std::max_align_t)));
+		chunk->size = size;
+		chunk->next = next;
+		if (m_current != nullptr)
+			m_current->next = chunk;
+		else
+			m_first = chunk;
+	}
+	m_current = chunk;
+	m_position = chunk_begin(chunk, sizeof(Chunk));
+	m_end = chunk_begin(chunk, chunk->size);
+}
+#pragma endregion
+
+#pragma region scope
+BigIntResourceScope::BigIntResourceScope(std::pmr::memory_resource& resource)
+	: m_previous(BigInt::set_memory_resource(&resource))
+{
+
+}
+
+BigIntResourceScope::~BigIntResourceScope()
+{
+	BigInt::set_memory_resource(m_previous);
+}
+#pragma endregion
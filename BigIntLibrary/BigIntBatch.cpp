@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntBatch.h"
+#include "include/BigIntLimbs.h"
+#include "include/BigIntThreadPool.h"
+
+namespace
+{
+	using bigint_detail::limb_t;
+
+	// Inputs of at least this many digits in total are split in parallel chunks
+	constexpr size_t PARALLEL_BATCH_DIGITS = 1 << 16;
+
+	// Number of chunks for a batch of the given digits: one without a pool
+	size_t batch_chunks(size_t digits, size_t count)
+	{
+		BigIntThreadPool* const pool = BigInt::thread_pool();
+		if (pool == nullptr)
+			return 1;
+		return std::max<size_t>(std::min({ pool->size(), digits / PARALLEL_BATCH_DIGITS, count }), 1);
+	}
+
+	// Calls body(chunk, begin, end) on the chunks of [0, count), as tasks of the pool
+	template <typename Body>
+	void for_chunks(size_t chunks, size_t count, Body body)
+	{
+		bigint_detail::TaskGroup group(chunks > 1 ? BigInt::thread_pool() : nullptr);
+		for (size_t k = 1; k < chunks; ++k)
+			group.run([=] { body(k, count * k / chunks, count * (k + 1) / chunks); });
+		body(0, 0, count / chunks);
+		group.wait();
+	}
+
+	// Carry-save addition: sum[0..an) += a[0..an) without propagating the carries, the
+	// carry out of limb i is counted in carries[i + 1]
+	void carry_save_add(limb_t* sum, limb_t* carries, const limb_t* a, size_t an)
+	{
+		for (size_t i = 0; i < an; ++i)
+		{
+			const limb_t s = sum[i] + a[i];
+			carries[i + 1] += s < a[i];
+			sum[i] = s;
+		}
+	}
+
+	// Balanced product tree over values[0..count), prefix[i] holds the digits of the
+	// values before i. The halves run in parallel when they are large
+	BigInt product_tree(const BigInt* values, size_t count, const size_t* prefix)
+	{
+		if (count == 1)
+			return values[0];
+		if (count == 2)
+			return values[0] * values[1];
+		// Split where about half of the digits are on each side
+		const size_t middle_digits = prefix[0] + (prefix[count] - prefix[0]) / 2;
+		size_t middle = std::lower_bound(prefix, prefix + count, middle_digits) - prefix;
+		middle = std::min(std::max<size_t>(middle, 1), count - 1);
+
+		BigInt high;
+		bigint_detail::TaskGroup group(bigint_detail::parallel_pool((prefix[count] - prefix[0]) / 2));
+		group.run([&] { high = product_tree(values + middle, count - middle, prefix + middle); });
+		BigInt low = product_tree(values, middle, prefix);
+		group.wait();
+		low *= high;
+		return low;
+	}
+}
+
+BigInt sum(const BigInt* values, size_t count)
+{
+	if (count == 0)
+		return BigInt();
+	size_t n = 0;
+	size_t digits = 0;
+	bool negative = false;
+	for (size_t i = 0; i < count; ++i)
+	{
+		n = std::max(n, values[i].num_digits());
+		digits += values[i].num_digits();
+		negative |= values[i].is_negative();
+	}
+	// One more limb holds the carries out of count values
+	++n;
+
+	// Every chunk accumulates the positive and the negative values apart, each side in a
+	// sum and its carries
+	const size_t chunks = batch_chunks(digits, count);
+	const size_t sides = negative ? 2 : 1;
+	std::vector<limb_t> scratch(chunks * sides * 2 * n, 0);
+	const auto sum_of = [&](size_t chunk, size_t side)
+	{
+		return scratch.data() + (chunk * sides + side) * 2 * n;
+	};
+	for_chunks(chunks, count, [&](size_t chunk, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			limb_t* const side = sum_of(chunk, values[i].is_negative() ? 1 : 0);
+			carry_save_add(side, side + n, values[i].m_digits.data(), values[i].num_digits());
+		}
+		for (size_t side = 0; side < sides; ++side)
+			bigint_detail::add_n(sum_of(chunk, side), sum_of(chunk, side), sum_of(chunk, side) + n, n);
+	});
+
+	// Chunk 0 collects the totals, they fit n limbs
+	for (size_t chunk = 1; chunk < chunks; ++chunk)
+	{
+		for (size_t side = 0; side < sides; ++side)
+			bigint_detail::add_n(sum_of(0, side), sum_of(0, side), sum_of(chunk, side), n);
+	}
+	const limb_t* positive = sum_of(0, 0);
+	const limb_t* subtracted = nullptr;
+	BigInt result;
+	if (negative)
+	{
+		subtracted = sum_of(0, 1);
+		if (bigint_detail::cmp_n(positive, subtracted, n) < 0)
+		{
+			std::swap(positive, subtracted);
+			result.set_sign(Sign::negative);
+		}
+	}
+	result.m_digits.resize(n, 0);
+	if (subtracted != nullptr)
+		bigint_detail::sub_n(result.m_digits.data(), positive, subtracted, n);
+	else
+		std::copy(positive, positive + n, result.m_digits.data());
+	result.remove_leading_zeros();
+	return result;
+}
+
+BigInt sum(const std::vector<BigInt>& values)
+{
+	return sum(values.data(), values.size());
+}
+
+BigInt product(const BigInt* values, size_t count)
+{
+	if (count == 0)
+		return BigInt(1);
+	std::vector<size_t> prefix(count + 1, 0);
+	for (size_t i = 0; i < count; ++i)
+		prefix[i + 1] = prefix[i] + values[i].num_digits();
+	return product_tree(values, count, prefix.data());
+}
+
+BigInt product(const std::vector<BigInt>& values)
+{
+	return product(values.data(), values.size());
+}
+
+void add(BigInt* result, const BigInt* lhs, const BigInt* rhs, size_t count)
+{
+	size_t digits = 0;
+	for (size_t i = 0; i < count; ++i)
+		digits += lhs[i].num_digits() + rhs[i].num_digits();
+	for_chunks(batch_chunks(digits, count), count, [=](size_t, size_t begin, size_t end)
+	{
+		// In place, so the digits of result are reused when they are large enough
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (&result[i] == &rhs[i])
+			{
+				result[i] += lhs[i];
+			}
+			else
+			{
+				result[i] = lhs[i];
+				result[i] += rhs[i];
+			}
+		}
+	});
+}
+
+std::vector<BigInt> add(const std::vector<BigInt>& lhs, const std::vector<BigInt>& rhs)
+{
+	if (lhs.size() != rhs.size())
+	{
+		throw std::invalid_argument("BigInt batches of different sizes\n");
+	}
+	std::vector<BigInt> result(lhs.size());
+	add(result.data(), lhs.data(), rhs.data(), lhs.size());
+	return result;
+}
+
+void mul(BigInt* result, const BigInt* lhs, const BigInt* rhs, size_t count)
+{
+	size_t digits = 0;
+	for (size_t i = 0; i < count; ++i)
+		digits += lhs[i].num_digits() + rhs[i].num_digits();
+	for_chunks(batch_chunks(digits, count), count, [=](size_t, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+			result[i] = lhs[i] * rhs[i];
+	});
+}
+
+std::vector<BigInt> mul(const std::vector<BigInt>& lhs, const std::vector<BigInt>& rhs)
+{
+	if (lhs.size() != rhs.size())
+	{
+		throw std::invalid_argument("BigInt batches of different sizes\n");
+	}
+	std::vector<BigInt> result(lhs.size());
+	mul(result.data(), lhs.data(), rhs.data(), lhs.size());
+	return result;
+}
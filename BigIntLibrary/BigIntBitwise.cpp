@@ -0,0 +1,393 @@
+#include <atomic>
+#include <cstddef>
+
+#include "include/BigIntLimbs.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BIGINT_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles the intrinsics of any instruction set without per function targets
+#define BIGINT_TARGET(features)
+#else
+#define BIGINT_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+/*
+ * Bitwise, shift and comparison kernels on limb ranges.
+ * Every kernel has a scalar version and, on x86-64, an AVX2 (4 limbs per step) and
+ * an AVX-512 (8 limbs per step) version compiled for their instruction set only.
+ * The first call detects what the CPU and the OS support and picks the widest one;
+ * the selection is a table of function pointers, so the cost per call is an
+ * indirect call. The vector loops leave the last limbs to the scalar code.
+ * The shifts are funnel shifts: every output limb combines two adjacent input limbs.
+ */
+namespace bigint_detail
+{
+	namespace
+	{
+		typedef void (*binary_kernel)(limb_t*, const limb_t*, const limb_t*, size_t);
+		typedef limb_t (*shift_kernel)(limb_t*, const limb_t*, size_t, unsigned int);
+		typedef size_t (*difference_kernel)(const limb_t*, const limb_t*, size_t);
+
+		struct BitwiseKernels
+		{
+			binary_kernel and_n;
+			binary_kernel or_n;
+			binary_kernel xor_n;
+			shift_kernel lshift;
+			shift_kernel rshift;
+			difference_kernel top_difference;
+		};
+
+#pragma region scalar
+		void and_scalar(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				r[i] = a[i] & b[i];
+		}
+
+		void or_scalar(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				r[i] = a[i] | b[i];
+		}
+
+		void xor_scalar(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+				r[i] = a[i] ^ b[i];
+		}
+
+		// Output limbs [0, end) of the left shift, from the top so r may sit above a
+		void lshift_limbs(limb_t* r, const limb_t* a, size_t end, unsigned int count)
+		{
+			const unsigned int back = LIMB_BITS - count;
+			for (size_t i = end; i-- > 1;)
+				r[i] = (a[i] << count) | (a[i - 1] >> back);
+			if (end > 0)
+				r[0] = a[0] << count;
+		}
+
+		// Output limbs [begin, n) of the right shift, from the bottom so r may sit below a
+		void rshift_limbs(limb_t* r, const limb_t* a, size_t begin, size_t n, unsigned int count)
+		{
+			const unsigned int back = LIMB_BITS - count;
+			for (size_t i = begin; i + 1 < n; ++i)
+				r[i] = (a[i] >> count) | (a[i + 1] << back);
+			if (begin < n)
+				r[n - 1] = a[n - 1] >> count;
+		}
+
+		limb_t lshift_scalar(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = n > 0 ? a[n - 1] >> (LIMB_BITS - count) : 0;
+			lshift_limbs(r, a, n, count);
+			return out;
+		}
+
+		limb_t rshift_scalar(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = n > 0 ? a[0] << (LIMB_BITS - count) : 0;
+			rshift_limbs(r, a, 0, n, count);
+			return out;
+		}
+
+		size_t top_difference_scalar(const limb_t* a, const limb_t* b, size_t n)
+		{
+			for (size_t i = n; i-- > 0;)
+			{
+				if (a[i] != b[i])
+					return i + 1;
+			}
+			return 0;
+		}
+
+		const BitwiseKernels SCALAR_KERNELS = { and_scalar, or_scalar, xor_scalar, lshift_scalar, rshift_scalar, top_difference_scalar };
+#pragma endregion
+
+#if defined(BIGINT_X86_64)
+#pragma region avx2
+		BIGINT_TARGET("avx2") void and_avx2(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+				const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), _mm256_and_si256(x, y));
+			}
+			and_scalar(r + i, a + i, b + i, n - i);
+		}
+
+		BIGINT_TARGET("avx2") void or_avx2(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+				const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), _mm256_or_si256(x, y));
+			}
+			or_scalar(r + i, a + i, b + i, n - i);
+		}
+
+		BIGINT_TARGET("avx2") void xor_avx2(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+				const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), _mm256_xor_si256(x, y));
+			}
+			xor_scalar(r + i, a + i, b + i, n - i);
+		}
+
+		BIGINT_TARGET("avx2") limb_t lshift_avx2(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = n > 0 ? a[n - 1] >> (LIMB_BITS - count) : 0;
+			const __m128i left = _mm_cvtsi32_si128(static_cast<int>(count));
+			const __m128i right = _mm_cvtsi32_si128(static_cast<int>(LIMB_BITS - count));
+			// Limbs [i - 4, i) need a[i - 5], both loads happen before the store
+			size_t i = n;
+			for (; i >= 5; i -= 4)
+			{
+				const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i - 4));
+				const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i - 5));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i - 4), _mm256_or_si256(_mm256_sll_epi64(high, left), _mm256_srl_epi64(low, right)));
+			}
+			lshift_limbs(r, a, i, count);
+			return out;
+		}
+
+		BIGINT_TARGET("avx2") limb_t rshift_avx2(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = n > 0 ? a[0] << (LIMB_BITS - count) : 0;
+			const __m128i right = _mm_cvtsi32_si128(static_cast<int>(count));
+			const __m128i left = _mm_cvtsi32_si128(static_cast<int>(LIMB_BITS - count));
+			// Limbs [i, i + 4) need a[i + 4], both loads happen before the store
+			size_t i = 0;
+			for (; i + 5 <= n; i += 4)
+			{
+				const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+				const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 1));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), _mm256_or_si256(_mm256_srl_epi64(low, right), _mm256_sll_epi64(high, left)));
+			}
+			rshift_limbs(r, a, i, n, count);
+			return out;
+		}
+
+		// Four limbs per step from the top, the lanes compared equal set their movemask bit
+		BIGINT_TARGET("avx2") size_t top_difference_avx2(const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = n;
+			for (; i >= 4; i -= 4)
+			{
+				const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i - 4));
+				const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i - 4));
+				const limb_t equal = static_cast<limb_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(x, y))));
+				if (equal != 0xF)
+					return i - 4 + (LIMB_BITS - count_leading_zeros(~equal & 0xF));
+			}
+			return top_difference_scalar(a, b, i);
+		}
+
+		const BitwiseKernels AVX2_KERNELS = { and_avx2, or_avx2, xor_avx2, lshift_avx2, rshift_avx2, top_difference_avx2 };
+#pragma endregion
+
+#pragma region avx512
+#if defined(__GNUC__) && !defined(__clang__)
+		// The AVX-512 shifts of the GCC headers pass _mm512_undefined_epi32() as their
+		// unused merge source, which -Wmaybe-uninitialized reports once inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+		BIGINT_TARGET("avx512f") void and_avx512(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_si512(r + i, _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+			and_scalar(r + i, a + i, b + i, n - i);
+		}
+
+		BIGINT_TARGET("avx512f") void or_avx512(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_si512(r + i, _mm512_or_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+			or_scalar(r + i, a + i, b + i, n - i);
+		}
+
+		BIGINT_TARGET("avx512f") void xor_avx512(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+				_mm512_storeu_si512(r + i, _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+			xor_scalar(r + i, a + i, b + i, n - i);
+		}
+
+		BIGINT_TARGET("avx512f") limb_t lshift_avx512(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = n > 0 ? a[n - 1] >> (LIMB_BITS - count) : 0;
+			const __m128i left = _mm_cvtsi32_si128(static_cast<int>(count));
+			const __m128i right = _mm_cvtsi32_si128(static_cast<int>(LIMB_BITS - count));
+			size_t i = n;
+			for (; i >= 9; i -= 8)
+			{
+				const __m512i high = _mm512_loadu_si512(a + i - 8);
+				const __m512i low = _mm512_loadu_si512(a + i - 9);
+				_mm512_storeu_si512(r + i - 8, _mm512_or_si512(_mm512_sll_epi64(high, left), _mm512_srl_epi64(low, right)));
+			}
+			lshift_limbs(r, a, i, count);
+			return out;
+		}
+
+		BIGINT_TARGET("avx512f") limb_t rshift_avx512(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = n > 0 ? a[0] << (LIMB_BITS - count) : 0;
+			const __m128i right = _mm_cvtsi32_si128(static_cast<int>(count));
+			const __m128i left = _mm_cvtsi32_si128(static_cast<int>(LIMB_BITS - count));
+			size_t i = 0;
+			for (; i + 9 <= n; i += 8)
+			{
+				const __m512i low = _mm512_loadu_si512(a + i);
+				const __m512i high = _mm512_loadu_si512(a + i + 1);
+				_mm512_storeu_si512(r + i, _mm512_or_si512(_mm512_srl_epi64(low, right), _mm512_sll_epi64(high, left)));
+			}
+			rshift_limbs(r, a, i, n, count);
+			return out;
+		}
+
+		BIGINT_TARGET("avx512f") size_t top_difference_avx512(const limb_t* a, const limb_t* b, size_t n)
+		{
+			size_t i = n;
+			for (; i >= 8; i -= 8)
+			{
+				const __mmask8 different = _mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a + i - 8), _mm512_loadu_si512(b + i - 8));
+				if (different != 0)
+					return i - 8 + (LIMB_BITS - count_leading_zeros(different));
+			}
+			return top_difference_scalar(a, b, i);
+		}
+
+		const BitwiseKernels AVX512_KERNELS = { and_avx512, or_avx512, xor_avx512, lshift_avx512, rshift_avx512, top_difference_avx512 };
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#pragma endregion
+#endif
+
+#pragma region dispatch
+		SimdLevel detect_simd_level()
+		{
+#if defined(BIGINT_X86_64) && defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return SimdLevel::scalar;
+			// The OS must save the vector registers (XSAVE enabled, XCR0 state bits)
+			__cpuid(info, 1);
+			if (((info[2] >> 27) & 1) == 0)
+				return SimdLevel::scalar;
+			const unsigned long long xcr0 = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+			if (((info[1] >> 16) & 1) != 0 && (xcr0 & 0xE6) == 0xE6)
+				return SimdLevel::avx512;
+			if (((info[1] >> 5) & 1) != 0 && (xcr0 & 0x6) == 0x6)
+				return SimdLevel::avx2;
+			return SimdLevel::scalar;
+#elif defined(BIGINT_X86_64)
+			// libgcc also checks that the OS saves the registers
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+				return SimdLevel::avx512;
+			if (__builtin_cpu_supports("avx2"))
+				return SimdLevel::avx2;
+			return SimdLevel::scalar;
+#else
+			return SimdLevel::scalar;
+#endif
+		}
+
+		const BitwiseKernels* kernels_for(SimdLevel level)
+		{
+#if defined(BIGINT_X86_64)
+			if (level == SimdLevel::avx512)
+				return &AVX512_KERNELS;
+			if (level == SimdLevel::avx2)
+				return &AVX2_KERNELS;
+#endif
+			return &SCALAR_KERNELS;
+		}
+
+		SimdLevel supported_simd_level()
+		{
+			static const SimdLevel level = detect_simd_level();
+			return level;
+		}
+
+		std::atomic<const BitwiseKernels*>& active_kernels()
+		{
+			static std::atomic<const BitwiseKernels*> kernels{ kernels_for(supported_simd_level()) };
+			return kernels;
+		}
+
+		const BitwiseKernels& kernels()
+		{
+			return *active_kernels().load(std::memory_order_relaxed);
+		}
+
+		std::atomic<SimdLevel>& active_level()
+		{
+			static std::atomic<SimdLevel> level{ supported_simd_level() };
+			return level;
+		}
+#pragma endregion
+	}
+
+	SimdLevel simd_level()
+	{
+		return active_level().load(std::memory_order_relaxed);
+	}
+
+	SimdLevel set_simd_level(SimdLevel level)
+	{
+		if (level > supported_simd_level())
+			level = supported_simd_level();
+		active_kernels().store(kernels_for(level), std::memory_order_relaxed);
+		return active_level().exchange(level, std::memory_order_relaxed);
+	}
+
+	void and_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+	{
+		kernels().and_n(r, a, b, n);
+	}
+
+	void or_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+	{
+		kernels().or_n(r, a, b, n);
+	}
+
+	void xor_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+	{
+		kernels().xor_n(r, a, b, n);
+	}
+
+	limb_t lshift(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+	{
+		return kernels().lshift(r, a, n, count);
+	}
+
+	limb_t rshift(limb_t* r, const limb_t* a, size_t n, unsigned int count)
+	{
+		return kernels().rshift(r, a, n, count);
+	}
+
+	size_t top_difference(const limb_t* a, const limb_t* b, size_t n)
+	{
+		return kernels().top_difference(a, b, n);
+	}
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+#include "include/BigIntView.h"
+
+namespace
+{
+	using bigint_detail::limb_t;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	constexpr bool HOST_BIG_ENDIAN = true;
+#else
+	constexpr bool HOST_BIG_ENDIAN = false;
+#endif
+
+	limb_t byte_swap(limb_t x)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_bswap64(x);
+#elif defined(_MSC_VER)
+		return _byteswap_uint64(x);
+#else
+		limb_t swapped = 0;
+		for (int i = 0; i < 8; ++i, x >>= 8)
+			swapped = (swapped << 8) | (x & 0xFF);
+		return swapped;
+#endif
+	}
+
+	void check_word_size(size_t word_size)
+	{
+		if (word_size == 0)
+		{
+			throw std::invalid_argument("The words of the binary format need at least one byte");
+		}
+	}
+
+	// Where the bytes of a number of size bytes go in a buffer: byte s of the magnitude
+	// (least significant first) is at position(s)
+	class ByteLayout
+	{
+	public:
+		ByteLayout(size_t size, Endian word_order, size_t word_size, Endian byte_order)
+			: m_size(size), m_word_size(word_size), m_words_big(is_big(word_order)),
+			// The order of the bytes of one byte words makes no difference
+			m_bytes_big(word_size == 1 ? m_words_big : is_big(byte_order))
+		{
+		}
+		size_t position(size_t s) const
+		{
+			const size_t word = s / m_word_size;
+			const size_t byte = s % m_word_size;
+			return (m_words_big ? m_size / m_word_size - 1 - word : word) * m_word_size
+				+ (m_bytes_big ? m_word_size - 1 - byte : byte);
+		}
+		// The bytes are copied a limb at a time when the buffer is one little or big endian
+		// number, or when the words are limbs
+		bool by_limbs() const
+		{
+			return m_words_big == m_bytes_big || m_word_size == 8;
+		}
+		// by_limbs layouts: position of the bytes [s, s + 8)
+		size_t limb_position(size_t s) const
+		{
+			return m_words_big ? m_size - s - 8 : s;
+		}
+		// by_limbs layouts: the limb as stored in memory, or back
+		limb_t order(limb_t limb) const
+		{
+			return m_bytes_big != HOST_BIG_ENDIAN ? byte_swap(limb) : limb;
+		}
+
+	private:
+		size_t m_size;
+		size_t m_word_size;
+		bool m_words_big;
+		bool m_bytes_big;
+
+		static bool is_big(Endian order)
+		{
+			return order == Endian::big || (order == Endian::native && HOST_BIG_ENDIAN);
+		}
+	};
+}
+
+#pragma region bytes
+BigInt BigInt::from_bytes(const std::byte* data, size_t size, Endian word_order, size_t word_size, Endian byte_order)
+{
+	BigInt result;
+	result.assign_bytes(data, size, word_order, word_size, byte_order);
+	return result;
+}
+
+void BigInt::assign_bytes(const std::byte* data, size_t size, Endian word_order, size_t word_size, Endian byte_order)
+{
+	check_word_size(word_size);
+	if (size % word_size != 0)
+	{
+		throw std::invalid_argument("The binary value is not made of whole words");
+	}
+	const size_t n = std::max<size_t>((size + 7) / 8, 1);
+	m_digits.resize(n);
+	limb_t* const limbs = m_digits.data();
+	std::fill(limbs, limbs + n, 0);
+	const ByteLayout layout(size, word_order, word_size, byte_order);
+	size_t s = 0;
+	if (layout.by_limbs())
+	{
+		for (; s + 8 <= size; s += 8)
+		{
+			limb_t limb;
+			std::memcpy(&limb, data + layout.limb_position(s), sizeof(limb));
+			limbs[s / 8] = layout.order(limb);
+		}
+	}
+	for (; s < size; ++s)
+		limbs[s / 8] |= static_cast<limb_t>(data[layout.position(s)]) << (8 * (s % 8));
+	set_sign(Sign::positive);
+	remove_leading_zeros();
+}
+
+size_t BigInt::byte_size(size_t word_size) const
+{
+	return BigIntView(*this).byte_size(word_size);
+}
+
+size_t BigInt::to_bytes(std::byte* out, size_t capacity, Endian word_order, size_t word_size, Endian byte_order) const
+{
+	return BigIntView(*this).to_bytes(out, capacity, word_order, word_size, byte_order);
+}
+#pragma endregion
+
+#pragma region view
+BigInt BigIntView::to_bigint() const
+{
+	BigInt value;
+	if (m_size > 0)
+		value.m_digits.assign(m_limbs, m_limbs + m_size);
+	value.set_sign(m_negative ? Sign::negative : Sign::positive);
+	return value;
+}
+
+size_t BigIntView::byte_size(size_t word_size) const
+{
+	check_word_size(word_size);
+	if (m_size == 0)
+		return 0;
+	const size_t bytes = m_size * 8 - bigint_detail::count_leading_zeros(m_limbs[m_size - 1]) / 8;
+	return (bytes + word_size - 1) / word_size * word_size;
+}
+
+size_t BigIntView::to_bytes(std::byte* out, size_t capacity, Endian word_order, size_t word_size, Endian byte_order) const
+{
+	const size_t size = byte_size(word_size);
+	if (capacity < size)
+	{
+		throw std::length_error("The buffer is too small for the binary value");
+	}
+	// The words may pad the value past its limbs
+	const auto limb_at = [this](size_t k)
+	{
+		return k < m_size ? m_limbs[k] : 0;
+	};
+	const ByteLayout layout(size, word_order, word_size, byte_order);
+	size_t s = 0;
+	if (layout.by_limbs())
+	{
+		for (; s + 8 <= size; s += 8)
+		{
+			const limb_t limb = layout.order(limb_at(s / 8));
+			std::memcpy(out + layout.limb_position(s), &limb, sizeof(limb));
+		}
+	}
+	for (; s < size; ++s)
+		out[layout.position(s)] = static_cast<std::byte>(limb_at(s / 8) >> (8 * (s % 8)));
+	return size;
+}
+
+int compare(const BigIntView& lhs, const BigIntView& rhs)
+{
+	if (lhs.m_negative != rhs.m_negative)
+		return lhs.m_negative ? -1 : 1;
+	int magnitude = 0;
+	if (lhs.m_size != rhs.m_size)
+		magnitude = lhs.m_size < rhs.m_size ? -1 : 1;
+	else
+		magnitude = bigint_detail::cmp_n(lhs.m_limbs, rhs.m_limbs, lhs.m_size);
+	return lhs.m_negative ? -magnitude : magnitude;
+}
+#pragma endregion
@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "include/BigInt.h"
+#include "include/BigIntConstantTime.h"
+#include "include/BigIntLimbs.h"
+
+using bigint_detail::limb_t;
+using bigint_detail::LimbVector;
+
+namespace
+{
+	// Bits of the exponent consumed by every step of ConstantTimeModulus::pow. The
+	// exponent width is public: the window balances the 2^w table entries, all read at
+	// every step, against the bits / w multiplications
+	unsigned int pow_window_bits(size_t bits)
+	{
+		return bits <= 512 ? 4 : bits <= 1536 ? 5 : 6;
+	}
+
+	// The width bits of limbs[0..n) starting at bit low, width <= 64
+	limb_t bit_field(const limb_t* limbs, size_t n, size_t low, unsigned int width)
+	{
+		const size_t index = low / bigint_detail::LIMB_BITS;
+		const unsigned int shift = low % bigint_detail::LIMB_BITS;
+		limb_t field = limbs[index] >> shift;
+		if (shift + width > bigint_detail::LIMB_BITS && index + 1 < n)
+			field |= limbs[index + 1] << (bigint_detail::LIMB_BITS - shift);
+		return field & ((limb_t(1) << width) - 1);
+	}
+
+	void check_widths(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs)
+	{
+		if (lhs.size() != rhs.size())
+		{
+			throw std::invalid_argument("Constant time operands must have the same number of limbs");
+		}
+	}
+
+	// 1 when x is zero, 0 otherwise
+	limb_t is_zero_limb(limb_t x)
+	{
+		return ((x | (0 - x)) >> (bigint_detail::LIMB_BITS - 1)) ^ 1;
+	}
+
+	// r[0..n) += c, the carry runs through every limb. Returns the carry out
+	limb_t add_1_full(limb_t* r, size_t n, limb_t c)
+	{
+		for (size_t i = 0; i < n; ++i)
+			r[i] = bigint_detail::add_with_carry(r[i], 0, c);
+		return c;
+	}
+
+	// r[0..n) = -r[0..n) mod B^n when condition is 1, unchanged when it is 0
+	void negate_if(limb_t* r, size_t n, limb_t condition)
+	{
+		const limb_t mask = bigint_detail::mask_from(condition);
+		limb_t carry = condition;
+		for (size_t i = 0; i < n; ++i)
+			r[i] = bigint_detail::add_with_carry(r[i] ^ mask, 0, carry);
+	}
+
+	// Stores |x - y| in r (all of n limbs, r may alias y) and returns 1 if x < y
+	limb_t abs_sub_n(limb_t* r, const limb_t* x, const limb_t* y, size_t n)
+	{
+		const limb_t borrow = bigint_detail::sub_n(r, x, y, n);
+		negate_if(r, n, borrow);
+		return borrow;
+	}
+
+	// Scratch limbs needed by mul_n() for operands of n limbs:
+	// every level uses 6 * ceil(n / 2) + 2 limbs and recurses on ceil(n / 2)
+	size_t mul_n_scratch_size(size_t n)
+	{
+		size_t size = 0;
+		while (n > 1)
+		{
+			n = (n + 1) / 2;
+			size += 6 * n + 2;
+		}
+		return size;
+	}
+
+	// r[0..2n) = a[0..n) * b[0..n). The Karatsuba recursion of BigIntMultiplication.cpp
+	// with the sign of (a0 - a1)(b0 - b1) applied by masks instead of branches
+	void mul_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n, limb_t* scratch)
+	{
+		const bool square = a == b;
+		if (n < (square ? BigInt::thresholds().karatsuba_sqr : BigInt::thresholds().karatsuba_mul))
+		{
+			if (square)
+				bigint_detail::sqr_basecase(r, a, n);
+			else
+				bigint_detail::mul_basecase(r, a, n, b, n);
+			return;
+		}
+		const size_t l = (n + 1) / 2;
+		const size_t h = n - l;
+
+		limb_t* const da = scratch;
+		limb_t* const db = da + l;
+		limb_t* const z1 = db + l;
+		limb_t* const middle = z1 + 2 * l + 1;
+		limb_t* const next = middle + 2 * l + 1;
+
+		// |a0 - a1| and |b0 - b1|, the high halves are zero extended to l limbs
+		std::copy(a + l, a + n, da);
+		if (h < l)
+			da[h] = 0;
+		limb_t negative = abs_sub_n(da, a, da, l);
+		if (square)
+		{
+			negative = 0;
+		}
+		else
+		{
+			std::copy(b + l, b + n, db);
+			if (h < l)
+				db[h] = 0;
+			negative ^= abs_sub_n(db, b, db, l);
+		}
+
+		mul_n(z1, da, square ? da : db, l, next);
+		mul_n(r, a, b, l, next);
+		mul_n(r + 2 * l, a + l, b + l, h, next);
+
+		// middle = z0 + z2 -/+ z1 = a0 b1 + a1 b0 fits 2l + 1 limbs, so the
+		// arithmetic runs modulo B^(2l + 1) adding z1 or its two's complement
+		std::copy(r, r + 2 * l, middle);
+		middle[2 * l] = 0;
+		add_1_full(middle + 2 * h, 2 * l + 1 - 2 * h, bigint_detail::add_n(middle, middle, r + 2 * l, 2 * h));
+		z1[2 * l] = 0;
+		negate_if(z1, 2 * l + 1, negative ^ 1);
+		bigint_detail::add_n(middle, middle, z1, 2 * l + 1);
+
+		const size_t middle_n = std::min<size_t>(2 * l + 1, 2 * n - l);
+		add_1_full(r + l + middle_n, 2 * n - l - middle_n, bigint_detail::add_n(r + l, r + l, middle, middle_n));
+	}
+
+	const BigInt& odd_modulus(const BigInt& modulus)
+	{
+		if (modulus <= 1 || modulus % 2 == 0)
+		{
+			throw std::domain_error("Math error: the constant time modulus must be odd and greater than one\n");
+		}
+		return modulus;
+	}
+}
+
+#pragma region constant-time-int
+ConstantTimeInt::ConstantTimeInt(size_t limbs)
+	: m_limbs(limbs, 0)
+{
+	if (limbs == 0)
+	{
+		throw std::invalid_argument("A ConstantTimeInt needs at least one limb");
+	}
+}
+
+ConstantTimeInt::ConstantTimeInt(const BigInt& value, size_t limbs)
+	: ConstantTimeInt(limbs)
+{
+	if (value.is_negative())
+	{
+		throw std::domain_error("Constant time values are unsigned");
+	}
+	if (value.num_digits() > limbs)
+	{
+		throw std::length_error("The value does not fit the limbs of the ConstantTimeInt");
+	}
+	std::copy(value.m_digits.begin(), value.m_digits.end(), m_limbs.begin());
+}
+
+BigInt ConstantTimeInt::to_bigint() const
+{
+	BigInt value;
+	value.m_digits = m_limbs;
+	value.remove_leading_zeros();
+	return value;
+}
+#pragma endregion
+
+#pragma region constant-time-operations
+namespace constant_time
+{
+	limb_t add(ConstantTimeInt& result, const ConstantTimeInt& lhs, const ConstantTimeInt& rhs)
+	{
+		check_widths(lhs, rhs);
+		check_widths(result, lhs);
+		return bigint_detail::add_n(result.data(), lhs.data(), rhs.data(), lhs.size());
+	}
+
+	limb_t sub(ConstantTimeInt& result, const ConstantTimeInt& lhs, const ConstantTimeInt& rhs)
+	{
+		check_widths(lhs, rhs);
+		check_widths(result, lhs);
+		return bigint_detail::sub_n(result.data(), lhs.data(), rhs.data(), lhs.size());
+	}
+
+	ConstantTimeInt mul(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs)
+	{
+		ConstantTimeInt product(lhs.size() + rhs.size());
+		if (lhs.size() == rhs.size())
+		{
+			LimbVector scratch(mul_n_scratch_size(lhs.size()), 0);
+			mul_n(product.data(), lhs.data(), &lhs == &rhs ? lhs.data() : rhs.data(), lhs.size(), scratch.data());
+		}
+		else
+		{
+			bigint_detail::mul_basecase(product.data(), lhs.data(), lhs.size(), rhs.data(), rhs.size());
+		}
+		return product;
+	}
+
+	int compare(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs)
+	{
+		check_widths(lhs, rhs);
+		// The borrows out of lhs - rhs and rhs - lhs, every limb is visited
+		limb_t less = 0;
+		limb_t greater = 0;
+		for (size_t i = 0; i < lhs.size(); ++i)
+		{
+			bigint_detail::sub_with_borrow(lhs.data()[i], rhs.data()[i], less);
+			bigint_detail::sub_with_borrow(rhs.data()[i], lhs.data()[i], greater);
+		}
+		return static_cast<int>(greater) - static_cast<int>(less);
+	}
+
+	bool equal(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs)
+	{
+		check_widths(lhs, rhs);
+		limb_t difference = 0;
+		for (size_t i = 0; i < lhs.size(); ++i)
+			difference |= lhs.data()[i] ^ rhs.data()[i];
+		return is_zero_limb(difference) == 1;
+	}
+
+	void conditional_swap(ConstantTimeInt& lhs, ConstantTimeInt& rhs, limb_t condition)
+	{
+		check_widths(lhs, rhs);
+		const limb_t mask = bigint_detail::mask_from(condition);
+		for (size_t i = 0; i < lhs.size(); ++i)
+		{
+			const limb_t flip = mask & (lhs.data()[i] ^ rhs.data()[i]);
+			lhs.data()[i] ^= flip;
+			rhs.data()[i] ^= flip;
+		}
+	}
+}
+#pragma endregion
+
+#pragma region constant-time-modulus
+ConstantTimeModulus::ConstantTimeModulus(const BigInt& modulus)
+	: m_modulus(odd_modulus(modulus), modulus.num_digits()),
+	m_inverse(bigint_detail::montgomery_inverse(m_modulus.data()[0])),
+	m_r2((BigInt(1) << (2 * BIGINT_DIGIT_BITS * modulus.num_digits())) % modulus, modulus.num_digits()),
+	m_one((BigInt(1) << (BIGINT_DIGIT_BITS * modulus.num_digits())) % modulus, modulus.num_digits())
+{
+
+}
+
+size_t ConstantTimeModulus::scratch_size() const
+{
+	return 2 * size() + mul_n_scratch_size(size());
+}
+
+void ConstantTimeModulus::montgomery_mul(limb_t* result, const limb_t* lhs, const limb_t* rhs, limb_t* scratch) const
+{
+	const size_t n = size();
+	mul_n(scratch, lhs, rhs, n, scratch + 2 * n);
+	bigint_detail::redc(result, scratch, m_modulus.data(), n, m_inverse);
+}
+
+ConstantTimeInt ConstantTimeModulus::montgomery_mul(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs) const
+{
+	check_widths(lhs, m_modulus);
+	check_widths(rhs, m_modulus);
+	ConstantTimeInt result(size());
+	LimbVector scratch(scratch_size(), 0);
+	montgomery_mul(result.data(), lhs.data(), rhs.data(), scratch.data());
+	return result;
+}
+
+ConstantTimeInt ConstantTimeModulus::to_montgomery(const ConstantTimeInt& x) const
+{
+	// x * R^2 < B^n * m, within the range of the reduction even for x >= m
+	return montgomery_mul(x, m_r2);
+}
+
+ConstantTimeInt ConstantTimeModulus::from_montgomery(const ConstantTimeInt& x) const
+{
+	check_widths(x, m_modulus);
+	const size_t n = size();
+	ConstantTimeInt result(n);
+	LimbVector scratch(2 * n, 0);
+	std::copy(x.data(), x.data() + n, scratch.begin());
+	bigint_detail::redc(result.data(), scratch.data(), m_modulus.data(), n, m_inverse);
+	return result;
+}
+
+ConstantTimeInt ConstantTimeModulus::pow(const ConstantTimeInt& base, const ConstantTimeInt& exponent) const
+{
+	check_widths(base, m_modulus);
+	const size_t n = size();
+	const size_t bits = exponent.size() * BIGINT_DIGIT_BITS;
+	const unsigned int window_bits = pow_window_bits(bits);
+	const size_t entries = size_t(1) << window_bits;
+	LimbVector scratch(scratch_size(), 0);
+	// base^0 .. base^(entries - 1) in Montgomery form
+	LimbVector table(entries * n, 0);
+	std::copy(m_one.data(), m_one.data() + n, table.begin());
+	montgomery_mul(table.data() + n, base.data(), m_r2.data(), scratch.data());
+	for (size_t i = 2; i < entries; ++i)
+		montgomery_mul(table.data() + i * n, table.data() + (i - 1) * n, table.data() + n, scratch.data());
+
+	ConstantTimeInt result = m_one;
+	LimbVector selected(n, 0);
+	// The most significant window takes the bits left over by the others
+	for (size_t bit = bits; bit > 0;)
+	{
+		const unsigned int width = bit % window_bits != 0 ? bit % window_bits : window_bits;
+		for (unsigned int i = 0; i < width; ++i)
+			montgomery_mul(result.data(), result.data(), result.data(), scratch.data());
+		bit -= width;
+		const limb_t window = bit_field(exponent.data(), exponent.size(), bit, width);
+		// Every entry is read, the window only decides which one is kept
+		for (size_t i = 0; i < entries; ++i)
+			bigint_detail::select_n(selected.data(), bigint_detail::mask_from(is_zero_limb(i ^ window)), table.data() + i * n, selected.data(), n);
+		montgomery_mul(result.data(), result.data(), selected.data(), scratch.data());
+	}
+	return from_montgomery(result);
+}
+#pragma endregion
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+
+/*
+ * Division engine on raw limb ranges.
+ * Small divisors go through Knuth's algorithm D (TAOCP vol. 2, 4.3.1), larger
+ * ones through the recursive division of Burnikel and Ziegler, which splits a
+ * 2n by n limbs division in two 3/2n by n steps and turns most of the work into
+ * multiplications. The crossover is BigIntThresholds::dc_div.
+ */
+namespace bigint_detail
+{
+	namespace
+	{
+		// Knuth's algorithm D, see div_qr for the preconditions (with dn >= 2)
+		void div_qr_schoolbook(limb_t* q, limb_t* u, size_t un, const limb_t* d, size_t dn)
+		{
+			const limb_t d1 = d[dn - 1];
+			const limb_t d0 = d[dn - 2];
+			for (size_t j = un - dn; j-- > 0;)
+			{
+				// Current partial remainder: u[j..j+dn]
+				limb_t* const window = u + j;
+				const limb_t u2 = window[dn];
+				const limb_t u1 = window[dn - 1];
+				const limb_t u0 = window[dn - 2];
+
+				// Estimate the quotient digit from the top two limbs of the divisor,
+				// the estimate is at most one too large after the refinement
+				limb_t q_hat;
+				limb_t r_hat;
+				bool r_hat_overflow = false;
+				if (u2 < d1)
+				{
+					q_hat = div_wide(u2, u1, d1, r_hat);
+				}
+				else
+				{
+					q_hat = ~limb_t(0);
+					r_hat = u1 + d1;
+					r_hat_overflow = r_hat < u1;
+				}
+				while (!r_hat_overflow)
+				{
+					limb_t high;
+					const limb_t low = mul_wide(q_hat, d0, high);
+					if (high < r_hat || (high == r_hat && low <= u0))
+						break;
+					--q_hat;
+					r_hat += d1;
+					r_hat_overflow = r_hat < d1;
+				}
+
+				const limb_t borrow = submul_1(window, d, dn, q_hat);
+				const limb_t top = window[dn];
+				window[dn] = top - borrow;
+				if (top < borrow)
+				{
+					// The estimate was one too large: add the divisor back
+					--q_hat;
+					window[dn] += add_n(window, window, d, dn);
+				}
+				q[j] = q_hat;
+			}
+		}
+
+		// Divides np[0..2n) by the normalized d[0..n). Stores the low n quotient limbs
+		// in q, returns the most significant one (0 or 1) and leaves the remainder in
+		// np[0..n). The scratch must hold n limbs
+		limb_t div_qr_recursive(limb_t* q, limb_t* np, const limb_t* d, size_t n, limb_t* scratch)
+		{
+			if (n < BigInt::thresholds().dc_div)
+			{
+				limb_t q_high = 0;
+				if (cmp_n(np + n, d, n) >= 0)
+				{
+					sub_n(np + n, np + n, d, n);
+					q_high = 1;
+				}
+				div_qr_schoolbook(q, np, 2 * n, d, n);
+				return q_high;
+			}
+			const size_t lo = n / 2;
+			const size_t hi = n - lo;
+
+			// Top hi quotient limbs: divide the top 2 hi limbs by the top hi limbs of d,
+			// then correct the remainder with the low lo limbs of d
+			limb_t q_high = div_qr_recursive(q + lo, np + 2 * lo, d + lo, hi, scratch);
+			mul(scratch, q + lo, hi, d, lo);
+			limb_t borrow = sub_n(np + lo, np + lo, scratch, n);
+			if (q_high)
+				borrow += sub_n(np + n, np + n, d, lo);
+			while (borrow > 0)
+			{
+				q_high -= sub_1(q + lo, q + lo, hi, 1);
+				borrow -= add_n(np + lo, np + lo, d, n);
+			}
+
+			// Low lo quotient limbs, same steps on the remainder
+			const limb_t q_low_high = div_qr_recursive(q, np + hi, d + hi, lo, scratch);
+			mul(scratch, d, hi, q, lo);
+			borrow = sub_n(np, np, scratch, n);
+			if (q_low_high)
+				borrow += sub_n(np + lo, np + lo, d, hi);
+			while (borrow > 0)
+			{
+				sub_1(q, q, lo, 1);
+				borrow -= add_n(np, np, d, n);
+			}
+			return q_high;
+		}
+	}
+
+	void div_qr(limb_t* q, limb_t* u, size_t un, const limb_t* d, size_t dn)
+	{
+		assert(un >= dn && dn >= 1 && (d[dn - 1] >> (LIMB_BITS - 1)) == 1);
+		const size_t qn = un - dn;
+		if (dn == 1)
+		{
+			limb_t remainder = u[qn];
+			for (size_t i = qn; i-- > 0;)
+				q[i] = div_wide(remainder, u[i], d[0], remainder);
+			u[0] = remainder;
+			return;
+		}
+		if (dn < BigInt::thresholds().dc_div)
+		{
+			div_qr_schoolbook(q, u, un, d, dn);
+			return;
+		}
+		// The quotient limbs that do not fill a dn sized block are computed with
+		// algorithm D, every following block with a 2 dn by dn recursive division
+		const size_t first = qn % dn;
+		if (first > 0)
+			div_qr_schoolbook(q + qn - first, u + qn - first, dn + first, d, dn);
+		std::vector<limb_t> scratch(dn);
+		for (size_t position = qn - first; position > 0;)
+		{
+			position -= dn;
+			const limb_t q_high = div_qr_recursive(q + position, u + position, d, dn, scratch.data());
+			assert(q_high == 0);
+			(void)q_high;
+		}
+	}
+}
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+
+/*
+ * Greatest common divisors.
+ * The operands are reduced by steps (u, v) <- (m00 u + m01 v, m10 u + m11 v) of
+ * integer matrices of determinant +-1, which keep the gcd; the cofactors of
+ * extended_gcd are the product of these matrices.
+ * - Large operands (BigIntThresholds::hgcd) go through the half-gcd recursion: the
+ *   steps that halve the top half of the limbs also halve the whole values, so two
+ *   recursive calls on half sizes and a few products halve the operands.
+ * - Medium ones take Lehmer steps: single precision Euclid on the leading 61 bits,
+ *   applied to the full values once per about 30 bits of quotients.
+ * - Single limbs end with the binary gcd.
+ */
+namespace bigint_detail
+{
+	// Product of the steps taken so far: the current values are (m00 u + m01 v, m10 u + m11 v)
+	// for the initial (u, v)
+	struct GcdMatrix
+	{
+		BigInt m00 = 1;
+		BigInt m01 = 0;
+		BigInt m10 = 0;
+		BigInt m11 = 1;
+	};
+
+	class GcdSteps
+	{
+	public:
+		// gcd(u, v) for u >= v >= 0. With a matrix, the steps leading to (gcd, 0) are added to it
+		static BigInt euclid(BigInt u, BigInt v, GcdMatrix* m);
+
+	private:
+		static size_t size(const BigInt& x)
+		{
+			return x.num_digits();
+		}
+		// Applies the steps certified by the leading bits of u >= v (v of two limbs at least),
+		// returns false when not even one is certain
+		static bool lehmer_step(BigInt& u, BigInt& v, GcdMatrix* m, std::vector<limb_t>& scratch);
+		// (u, v) <- (v, u mod v)
+		static void division_step(BigInt& u, BigInt& v, GcdMatrix* m);
+		// Reduces u >= v > 0 until v has at most n / 2 + 1 of the n limbs of u
+		static void hgcd(BigInt& u, BigInt& v, GcdMatrix& m);
+		// Applies the half-gcd steps of the limbs of u >= v above the first p
+		static void reduce_top(BigInt& u, BigInt& v, size_t p, GcdMatrix& m);
+		static limb_t binary_gcd(limb_t a, limb_t b);
+	};
+
+	namespace
+	{
+		// m <- (a b; c d) m
+		void compose(GcdMatrix& m, const BigInt& a, const BigInt& b, const BigInt& c, const BigInt& d)
+		{
+			BigInt m00 = a * m.m00;
+			m00.addmul(b, m.m10);
+			BigInt m01 = a * m.m01;
+			m01.addmul(b, m.m11);
+			BigInt m10 = c * m.m00;
+			m10.addmul(d, m.m10);
+			BigInt m11 = c * m.m01;
+			m11.addmul(d, m.m11);
+			m.m00 = std::move(m00);
+			m.m01 = std::move(m01);
+			m.m10 = std::move(m10);
+			m.m11 = std::move(m11);
+		}
+
+		// r[0..n) = p x + q y for p and q of opposite signs, when the result fits n limbs
+		void combine(limb_t* r, const limb_t* x, const limb_t* y, size_t n, int64_t p, int64_t q)
+		{
+			if (p < q)
+			{
+				std::swap(x, y);
+				std::swap(p, q);
+			}
+			limb_t high = mul_1(r, x, n, static_cast<limb_t>(p));
+			high -= submul_1(r, y, n, static_cast<limb_t>(-q));
+			assert(high == 0);
+			(void)high;
+		}
+	}
+
+	BigInt GcdSteps::euclid(BigInt u, BigInt v, GcdMatrix* m)
+	{
+		std::vector<limb_t> scratch;
+		while (size(v) > 1)
+		{
+			if (size(v) >= BigInt::thresholds().hgcd)
+			{
+				GcdMatrix steps;
+				hgcd(u, v, steps);
+				if (m != nullptr)
+					compose(*m, steps.m00, steps.m01, steps.m10, steps.m11);
+				// Also the progress when v is too small for the half-gcd
+				if (!v.is_zero())
+					division_step(u, v, m);
+			}
+			else if (!lehmer_step(u, v, m, scratch))
+			{
+				division_step(u, v, m);
+			}
+		}
+		if (v.is_zero())
+			return u;
+		if (m != nullptr)
+		{
+			while (!v.is_zero())
+				division_step(u, v, m);
+			return u;
+		}
+		const BigInt r = u % v;
+		BigInt g;
+		g.m_digits[0] = binary_gcd(v.m_digits[0], r.m_digits[0]);
+		return g;
+	}
+
+	bool GcdSteps::lehmer_step(BigInt& u, BigInt& v, GcdMatrix* m, std::vector<limb_t>& scratch)
+	{
+		const size_t n = size(u);
+		// Leading 61 bits of u and the bits of v at the same position: the cofactors and
+		// their intermediate products stay within int64_t
+		const size_t shift = n * LIMB_BITS - count_leading_zeros(u.m_digits[n - 1]) - 61;
+		const auto leading = [shift](const BigInt& x)
+		{
+			const size_t k = shift / LIMB_BITS;
+			const unsigned int r = shift % LIMB_BITS;
+			limb_t bits = x.get_digit(k) >> r;
+			if (r > 0)
+				bits |= x.get_digit(k + 1) << (LIMB_BITS - r);
+			return static_cast<int64_t>(bits & ((limb_t(1) << 61) - 1));
+		};
+		int64_t x = leading(u);
+		int64_t y = leading(v);
+
+		// Knuth's algorithm L (TAOCP vol. 2, 4.5.2): q is a quotient of the full values
+		// when the extreme quotients allowed by the truncation agree
+		int64_t a = 1, b = 0, c = 0, d = 1;
+		while (y + c > 0 && y + d > 0)
+		{
+			const int64_t q = (x + a) / (y + c);
+			if (q != (x + b) / (y + d))
+				break;
+			int64_t t = a - q * c;
+			a = c;
+			c = t;
+			t = b - q * d;
+			b = d;
+			d = t;
+			t = x - q * y;
+			x = y;
+			y = t;
+		}
+		if (b == 0)
+			return false;
+
+		// (u, v) <- (a u + b v, c u + d v), the signs alternate within a row
+		scratch.resize(2 * n);
+		v.m_digits.resize(n, 0);
+		combine(scratch.data(), u.m_digits.data(), v.m_digits.data(), n, a, b);
+		combine(scratch.data() + n, u.m_digits.data(), v.m_digits.data(), n, c, d);
+		std::copy(scratch.begin(), scratch.begin() + n, u.m_digits.begin());
+		std::copy(scratch.begin() + n, scratch.end(), v.m_digits.begin());
+		u.remove_leading_zeros();
+		v.remove_leading_zeros();
+		if (m != nullptr)
+			compose(*m, static_cast<long long>(a), static_cast<long long>(b), static_cast<long long>(c), static_cast<long long>(d));
+		return true;
+	}
+
+	void GcdSteps::division_step(BigInt& u, BigInt& v, GcdMatrix* m)
+	{
+		std::pair<BigInt, BigInt> qr = divmod(u, v);
+		u = std::move(v);
+		v = std::move(qr.second);
+		if (m != nullptr)
+		{
+			// (0 1; 1 -q) m
+			std::swap(m->m00, m->m10);
+			std::swap(m->m01, m->m11);
+			m->m10.submul(qr.first, m->m00);
+			m->m11.submul(qr.first, m->m01);
+		}
+	}
+
+	void GcdSteps::hgcd(BigInt& u, BigInt& v, GcdMatrix& m)
+	{
+		const size_t n = size(u);
+		const size_t s = n / 2 + 1;
+		if (n >= BigInt::thresholds().hgcd && size(v) > s)
+		{
+			// The top half reduced to a quarter brings the values to about 3n/4 limbs
+			reduce_top(u, v, n / 2, m);
+			if (size(v) > s)
+			{
+				// One quotient between the halves, then the top 2 (size - s) limbs
+				// reduced by half land about s limbs
+				division_step(u, v, &m);
+				const size_t un = size(u);
+				if (size(v) > s && 2 * s > un)
+					reduce_top(u, v, 2 * s - un, m);
+			}
+		}
+		// The last steps, and the small sizes
+		std::vector<limb_t> scratch;
+		while (size(v) > s)
+		{
+			if (!lehmer_step(u, v, &m, scratch))
+				division_step(u, v, &m);
+		}
+	}
+
+	void GcdSteps::reduce_top(BigInt& u, BigInt& v, size_t p, GcdMatrix& m)
+	{
+		BigInt top_u = u >> (p * BIGINT_DIGIT_BITS);
+		BigInt top_v = v >> (p * BIGINT_DIGIT_BITS);
+		if (top_v.is_zero())
+			return;
+		GcdMatrix steps;
+		hgcd(top_u, top_v, steps);
+
+		// Only the last few steps of the top limbs may not be steps of the full values:
+		// a negative or misordered result is turned back into u >= v >= 0, which keeps
+		// the determinant +-1
+		BigInt next_u = steps.m00 * u;
+		next_u.addmul(steps.m01, v);
+		BigInt next_v = steps.m10 * u;
+		next_v.addmul(steps.m11, v);
+		if (next_u.is_negative())
+		{
+			next_u = -next_u;
+			steps.m00 = -steps.m00;
+			steps.m01 = -steps.m01;
+		}
+		if (next_v.is_negative())
+		{
+			next_v = -next_v;
+			steps.m10 = -steps.m10;
+			steps.m11 = -steps.m11;
+		}
+		if (next_u < next_v)
+		{
+			std::swap(next_u, next_v);
+			std::swap(steps.m00, steps.m10);
+			std::swap(steps.m01, steps.m11);
+		}
+		u = std::move(next_u);
+		v = std::move(next_v);
+		compose(m, steps.m00, steps.m01, steps.m10, steps.m11);
+	}
+
+	limb_t GcdSteps::binary_gcd(limb_t a, limb_t b)
+	{
+		if (a == 0 || b == 0)
+			return a | b;
+		const unsigned int twos = count_trailing_zeros(a | b);
+		a >>= count_trailing_zeros(a);
+		while (b != 0)
+		{
+			b >>= count_trailing_zeros(b);
+			if (a > b)
+				std::swap(a, b);
+			b -= a;
+		}
+		return a << twos;
+	}
+}
+
+BigInt gcd(const BigInt& a, const BigInt& b)
+{
+	BigInt u = a;
+	BigInt v = b;
+	u.set_sign(Sign::positive);
+	v.set_sign(Sign::positive);
+	if (u < v)
+		std::swap(u, v);
+	return bigint_detail::GcdSteps::euclid(std::move(u), std::move(v), nullptr);
+}
+
+BigInt lcm(const BigInt& a, const BigInt& b)
+{
+	if (a.is_zero() || b.is_zero())
+		return 0;
+	BigInt result = a / gcd(a, b) * b;
+	result.set_sign(Sign::positive);
+	return result;
+}
+
+std::tuple<BigInt, BigInt, BigInt> extended_gcd(const BigInt& a, const BigInt& b)
+{
+	const BigInt sign_a = a.is_negative() ? -1 : 1;
+	const BigInt sign_b = b.is_negative() ? -1 : 1;
+	if (b.is_zero())
+		return std::make_tuple(a * sign_a, a.is_zero() ? BigInt(0) : sign_a, BigInt(0));
+	if (a.is_zero())
+		return std::make_tuple(b * sign_b, BigInt(0), sign_b);
+
+	BigInt u = a;
+	BigInt v = b;
+	u.set_sign(Sign::positive);
+	v.set_sign(Sign::positive);
+	const bool swapped = u < v;
+	if (swapped)
+		std::swap(u, v);
+	bigint_detail::GcdMatrix m;
+	const BigInt g = bigint_detail::GcdSteps::euclid(u, v, &m);
+	// (g, 0) = m (u, v)
+	BigInt x = swapped ? std::move(m.m01) : std::move(m.m00);
+	x *= sign_a;
+
+	// The smallest cofactors: |x| <= |b| / 2g, then y follows
+	const BigInt period = b / g * sign_b;
+	x %= period;
+	if (x < 0)
+		x += period;
+	if ((x << 1) > period)
+		x -= period;
+	BigInt y = g;
+	y.submul(a, x);
+	y /= b;
+	return std::make_tuple(g, std::move(x), std::move(y));
+}
+
+BigInt modinv(const BigInt& a, const BigInt& m)
+{
+	if (!m.is_positive() || m.is_zero())
+	{
+		throw std::domain_error("Math error: the modulus must be positive\n");
+	}
+	BigInt r = a % m;
+	if (r.is_negative())
+		r += m;
+	BigInt g, x, y;
+	std::tie(g, x, y) = extended_gcd(r, m);
+	if (g != 1)
+	{
+		throw std::domain_error("Math error: the value is not invertible modulo m\n");
+	}
+	if (x.is_negative())
+		x += m;
+	return x;
+}
@@ -0,0 +1,137 @@
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "include/BigIntMapped.h"
+#include "include/BigIntStorage.h"
+
+namespace
+{
+	[[noreturn]] void mapping_failed(int error)
+	{
+		throw std::system_error(error, std::system_category(), "Could not map a file for BigInt digits");
+	}
+
+#if defined(_WIN32)
+	void* map_temporary(const std::string& directory, size_t bytes)
+	{
+		char path[MAX_PATH];
+		if (GetTempFileNameA(directory.c_str(), "big", 0, path) == 0)
+			mapping_failed(static_cast<int>(GetLastError()));
+		// Deleted when the last handle closes, the view keeps the file open until it is unmapped
+		const HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			mapping_failed(static_cast<int>(GetLastError()));
+		const uint64_t size = bytes;
+		const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+		const DWORD mapping_error = GetLastError();
+		CloseHandle(file);
+		if (mapping == nullptr)
+			mapping_failed(static_cast<int>(mapping_error));
+		void* const p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+		const DWORD view_error = GetLastError();
+		CloseHandle(mapping);
+		if (p == nullptr)
+			mapping_failed(static_cast<int>(view_error));
+		return p;
+	}
+
+	void unmap(void* p, size_t)
+	{
+		UnmapViewOfFile(p);
+	}
+#else
+	void* map_temporary(const std::string& directory, size_t bytes)
+	{
+		std::string path = directory + "/bigint-XXXXXX";
+		const int fd = mkstemp(&path[0]);
+		if (fd < 0)
+			mapping_failed(errno);
+		// Only the mapping refers to the file from now on
+		unlink(path.c_str());
+		if (ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+		{
+			const int error = errno;
+			close(fd);
+			mapping_failed(error);
+		}
+		void* const p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		const int error = errno;
+		close(fd);
+		if (p == MAP_FAILED)
+			mapping_failed(error);
+		// The limb kernels walk the digits in order: read ahead, and drop the pages behind
+		madvise(p, bytes, MADV_SEQUENTIAL);
+		return p;
+	}
+
+	void unmap(void* p, size_t bytes)
+	{
+		munmap(p, bytes);
+	}
+#endif
+}
+
+#pragma region mapped-resource
+BigIntMappedResource::BigIntMappedResource(const std::string& directory, size_t min_bytes, std::pmr::memory_resource* upstream)
+	: m_directory(directory.empty() ? std::filesystem::temp_directory_path().string() : directory),
+	m_min_bytes(min_bytes), m_upstream(upstream), m_mul_block_limbs(size_t(1) << 22), m_mapped_bytes(0)
+{
+
+}
+
+void BigIntMappedResource::set_mul_block_limbs(size_t limbs)
+{
+	if (limbs == 0)
+	{
+		throw std::invalid_argument("The blocks of the out of core multiplication need at least one limb");
+	}
+	m_mul_block_limbs = limbs;
+}
+
+size_t BigIntMappedResource::current_mul_block_limbs()
+{
+	const BigIntMappedResource* const mapped = dynamic_cast<const BigIntMappedResource*>(bigint_detail::current_limb_resource());
+	return mapped != nullptr ? mapped->m_mul_block_limbs : SIZE_MAX;
+}
+
+void* BigIntMappedResource::do_allocate(size_t bytes, size_t alignment)
+{
+	if (bytes < m_min_bytes)
+		return m_upstream->allocate(bytes, alignment);
+	// Mappings start on a page boundary, aligned enough for the limbs
+	void* const p = map_temporary(m_directory, bytes);
+	m_mapped_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	return p;
+}
+
+void BigIntMappedResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	if (bytes < m_min_bytes)
+	{
+		m_upstream->deallocate(p, bytes, alignment);
+		return;
+	}
+	unmap(p, bytes);
+	m_mapped_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool BigIntMappedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+#pragma endregion
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+#include "include/BigIntModulus.h"
+#include "include/BigIntPower.h"
+
+namespace bigint_detail
+{
+	limb_t montgomery_inverse(limb_t m0)
+	{
+		// Newton iteration on m0^-1 mod 2^64, every step doubles the correct low bits
+		limb_t inverse = m0;
+		for (int i = 0; i < 6; ++i)
+			inverse *= 2 - m0 * inverse;
+		return 0 - inverse;
+	}
+
+	void redc(limb_t* r, limb_t* t, const limb_t* m, size_t n, limb_t inverse)
+	{
+		// Row i clears t[i] adding a multiple of m, its carry limb is parked in the
+		// cleared t[i] and added to the upper half once, at the end
+		for (size_t i = 0; i < n; ++i)
+			t[i] = addmul_1(t + i, m, n, t[i] * inverse);
+		const limb_t top = add_n(t + n, t + n, t, n);
+		// t / B^n < 2m: subtract m when the sum carried out or is at least m
+		const limb_t borrow = sub_n(t, t + n, m, n);
+		select_n(r, mask_from(top | (borrow ^ 1)), t, t + n, n);
+	}
+}
+
+Modulus::Modulus(const BigInt& modulus)
+	: m_modulus(modulus), m_size(modulus.num_digits()), m_montgomery(false), m_inverse(0)
+{
+	if (!modulus.is_positive() || modulus.is_zero())
+	{
+		throw std::domain_error("Math error: the modulus must be positive\n");
+	}
+	// The only divisions: Barrett's mu, and B^2n mod m to enter the Montgomery form
+	BigInt b2n = BigInt(1) << (2 * m_size * BIGINT_DIGIT_BITS);
+	m_barrett_mu = b2n / m_modulus;
+	if (modulus.get_digit(0) & 1)
+	{
+		m_montgomery = true;
+		m_inverse = bigint_detail::montgomery_inverse(modulus.get_digit(0));
+		m_r2 = b2n % m_modulus;
+	}
+}
+
+BigInt Modulus::barrett_reduce(const BigInt& x) const
+{
+	// q = floor(floor(x / B^(n-1)) * mu / B^(n+1)) underestimates x / m by at most 2
+	const BigInt q = ((x >> ((m_size - 1) * BIGINT_DIGIT_BITS)) * m_barrett_mu) >> ((m_size + 1) * BIGINT_DIGIT_BITS);
+	BigInt r = x - q * m_modulus;
+	while (r >= m_modulus)
+		r -= m_modulus;
+	return r;
+}
+
+BigInt Modulus::reduce(const BigInt& x) const
+{
+	if (x.is_positive() && x.num_digits() <= 2 * m_size)
+		return barrett_reduce(x);
+	// % takes the sign of the dividend here, move it to [0, m)
+	BigInt r = x % m_modulus;
+	if (r.is_negative())
+		r += m_modulus;
+	return r;
+}
+
+BigInt Modulus::mul(const BigInt& lhs, const BigInt& rhs) const
+{
+	return barrett_reduce(reduce(lhs) * reduce(rhs));
+}
+
+BigInt Modulus::pow(const BigInt& base, const BigInt& exponent) const
+{
+	if (exponent.is_negative())
+	{
+		throw std::domain_error("Negative exponents are not supported for BigInt types.");
+	}
+	if (m_modulus == 1)
+	{
+		return 0;
+	}
+	if (exponent.is_zero())
+	{
+		return 1;
+	}
+	return m_montgomery ? montgomery_pow(base, exponent) : barrett_pow(base, exponent);
+}
+
+BigInt Modulus::montgomery_pow(const BigInt& base, const BigInt& exponent) const
+{
+	using bigint_detail::LimbVector;
+	const size_t n = m_size;
+	const digit_t* const m = m_modulus.m_digits.data();
+	// Products live in t, the operands are n limbs values in [0, m)
+	LimbVector t(2 * n, 0);
+	const auto multiply = [&](LimbVector& x, const LimbVector& y)
+	{
+		if (&x == &y)
+			bigint_detail::sqr(t.data(), x.data(), n);
+		else
+			bigint_detail::mul(t.data(), x.data(), n, y.data(), n);
+		bigint_detail::redc(x.data(), t.data(), m, n, m_inverse);
+	};
+	const auto square = [&](LimbVector& x)
+	{
+		multiply(x, x);
+	};
+	const auto to_limbs = [n](const BigInt& x)
+	{
+		LimbVector limbs(x.m_digits);
+		limbs.set_flag(false);
+		limbs.resize(n, 0);
+		return limbs;
+	};
+
+	// Montgomery form: x R mod m with R = B^n, entered multiplying by R^2 mod m
+	const LimbVector r2 = to_limbs(m_r2);
+	LimbVector one(n, 0);
+	one[0] = 1;
+	multiply(one, r2);
+	LimbVector x = to_limbs(reduce(base));
+	multiply(x, r2);
+
+	LimbVector result = bigint_detail::window_power(one, x, exponent.m_digits.data(), exponent.num_digits(), square, multiply);
+	// Leave the Montgomery form: REDC of the value itself
+	std::fill(t.begin(), t.end(), 0);
+	std::copy(result.begin(), result.end(), t.begin());
+	bigint_detail::redc(result.data(), t.data(), m, n, m_inverse);
+
+	BigInt power;
+	power.m_digits = std::move(result);
+	power.remove_leading_zeros();
+	return power;
+}
+
+BigInt Modulus::barrett_pow(const BigInt& base, const BigInt& exponent) const
+{
+	const auto multiply = [this](BigInt& x, const BigInt& y)
+	{
+		x = barrett_reduce(x * y);
+	};
+	const auto square = [this](BigInt& x)
+	{
+		x = barrett_reduce(x * x);
+	};
+	return bigint_detail::window_power(BigInt(1), reduce(base), exponent.m_digits.data(), exponent.num_digits(), square, multiply);
+}
+
+BigInt powmod(const BigInt& base, const BigInt& exponent, const BigInt& modulus)
+{
+	return Modulus(modulus).pow(base, exponent);
+}
@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+#include "include/BigIntMapped.h"
+#include "include/BigIntThreadPool.h"
+
+/*
+ * Multiplication engine on raw limb ranges.
+ * The dispatcher chooses between schoolbook, Karatsuba, Toom-Cook 3-way and the
+ * NTT product (BigIntNtt.cpp) depending on the size of the smaller operand, using
+ * the thresholds returned by BigInt::thresholds() so that the crossovers can be
+ * calibrated per host.
+ * Squares go through the same algorithms with both operand pointers equal: the
+ * recursion keeps them equal, so every level evaluates a single operand and the
+ * leaves use the squaring basecase, which computes each cross product once.
+ * With a thread pool installed, the independent subproducts of the large operands
+ * run as parallel tasks (see BigIntThreadPool.h). With a mapped resource installed,
+ * the operands larger than its blocks are multiplied block by block (mul_blocked).
+ */
+namespace bigint_detail
+{
+	namespace
+	{
+		void mul_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n);
+
+		// Scratch limbs needed by karatsuba() for operands of n limbs:
+		// every level uses 6 * ceil(n / 2) + 2 limbs and recurses on ceil(n / 2)
+		size_t karatsuba_scratch_size(size_t n)
+		{
+			size_t size = 0;
+			while (n > 1)
+			{
+				n = (n + 1) / 2;
+				size += 6 * n + 2;
+			}
+			return size;
+		}
+
+		// Stores |x - y| in r (all of n limbs) and returns true if x < y
+		bool abs_sub_n(limb_t* r, const limb_t* x, const limb_t* y, size_t n)
+		{
+			if (cmp_n(x, y, n) < 0)
+			{
+				sub_n(r, y, x, n);
+				return true;
+			}
+			sub_n(r, x, y, n);
+			return false;
+		}
+
+		// r[0..2n) = a[0..n) * b[0..n) splitting each operand in two halves:
+		// a * b = z2 * B^2l + (z0 + z2 - (a0 - a1)(b0 - b1)) * B^l + z0
+		void karatsuba(limb_t* r, const limb_t* a, const limb_t* b, size_t n, limb_t* scratch)
+		{
+			const bool square = a == b;
+			if (n < (square ? BigInt::thresholds().karatsuba_sqr : BigInt::thresholds().karatsuba_mul))
+			{
+				if (square)
+					sqr_basecase(r, a, n);
+				else
+					mul_basecase(r, a, n, b, n);
+				return;
+			}
+			const size_t l = (n + 1) / 2;
+			const size_t h = n - l;
+
+			limb_t* const da = scratch;
+			limb_t* const db = da + l;
+			limb_t* const z1 = db + l;
+			limb_t* const middle = z1 + 2 * l;
+			limb_t* const next = middle + 2 * l + 2;
+
+			// |a0 - a1| and |b0 - b1|, the high halves are zero extended to l limbs
+			bool negative = false;
+			std::copy(a + l, a + n, da);
+			if (h < l)
+				da[h] = 0;
+			negative ^= abs_sub_n(da, a, da, l);
+			if (square)
+			{
+				// (a0 - a1)^2 is never negative
+				negative = false;
+			}
+			else
+			{
+				std::copy(b + l, b + n, db);
+				if (h < l)
+					db[h] = 0;
+				negative ^= abs_sub_n(db, b, db, l);
+			}
+
+			// z0 and z2 land directly in their final position. In parallel every
+			// subproduct needs its own scratch
+			BigIntThreadPool* const pool = parallel_pool(n);
+			std::vector<limb_t> z0_scratch(pool != nullptr ? karatsuba_scratch_size(l) : 0);
+			std::vector<limb_t> z2_scratch(pool != nullptr ? karatsuba_scratch_size(l) : 0);
+			TaskGroup group(pool);
+			limb_t* const z0_next = group.parallel() ? z0_scratch.data() : next;
+			limb_t* const z2_next = group.parallel() ? z2_scratch.data() : next;
+			group.run([=] { karatsuba(r, a, b, l, z0_next); });
+			if (h > 0)
+			{
+				group.run([=]
+				{
+					if (h == l)
+						karatsuba(r + 2 * l, a + l, b + l, h, z2_next);
+					else
+						mul_n(r + 2 * l, a + l, b + l, h);
+				});
+			}
+			karatsuba(z1, da, square ? da : db, l, next);
+			group.wait();
+
+			// middle = z0 + z2 -/+ z1 (always non negative)
+			std::copy(r, r + 2 * l, middle);
+			middle[2 * l] = 0;
+			middle[2 * l + 1] = 0;
+			add(middle, middle, 2 * l + 2, r + 2 * l, 2 * h);
+			if (negative)
+				add(middle, middle, 2 * l + 2, z1, 2 * l);
+			else
+				sub(middle, middle, 2 * l + 2, z1, 2 * l);
+
+			const size_t middle_n = std::min<size_t>(normalized_size(middle, 2 * l + 2), 2 * n - l);
+			const limb_t carry = add(r + l, r + l, 2 * n - l, middle, middle_n);
+			assert(carry == 0);
+			(void)carry;
+		}
+
+		// Exact division of a[0..n) by 3 in place
+		void divexact_by3(limb_t* a, size_t n)
+		{
+			const limb_t remainder = div_1(a, a, n, 3);
+			assert(remainder == 0);
+			(void)remainder;
+		}
+
+		// a[0..n) <<= count (the shifted out bits must be zero)
+		void lshift_in_place(limb_t* a, size_t n, unsigned int count)
+		{
+			const limb_t out = lshift(a, a, n, count);
+			assert(out == 0);
+			(void)out;
+		}
+
+		// Adds c[0..cn) to r[offset..rn) propagating the carry through r
+		void add_at(limb_t* r, size_t rn, size_t offset, const limb_t* c, size_t cn)
+		{
+			cn = std::min(normalized_size(c, cn), rn - offset);
+			const limb_t carry = add(r + offset, r + offset, rn - offset, c, cn);
+			assert(carry == 0);
+			(void)carry;
+		}
+
+		// r[0..2n) = a[0..n) * b[0..n) splitting each operand in three parts of k limbs
+		// and evaluating the product polynomial in 0, 1, -1, 2 and infinity
+		void toom3(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			const size_t k = (n + 2) / 3;
+			const size_t s = n - 2 * k;
+			// Evaluations take k + 1 limbs, their products 2k + 2
+			const size_t e = k + 1;
+			const size_t p = 2 * e;
+			std::vector<limb_t> buffer(6 * e + 4 * p, 0);
+			limb_t* const pa = buffer.data();
+			limb_t* const pb = pa + e;
+			limb_t* const ma = pb + e;
+			limb_t* const mb = ma + e;
+			limb_t* const qa = mb + e;
+			limb_t* const qb = qa + e;
+			limb_t* const v1 = qb + e;
+			limb_t* const vm1 = v1 + p;
+			limb_t* const v2 = vm1 + p;
+			limb_t* const t = v2 + p;
+
+			// Evaluates x0 + x1 t + x2 t^2 in 1 (ones), -1 (minus_ones) and 2 (twos),
+			// returns true if the value in -1 is negative
+			const auto evaluate = [k, s, e](const limb_t* x, limb_t* ones, limb_t* minus_ones, limb_t* twos)
+			{
+				const limb_t* const x0 = x;
+				const limb_t* const x1 = x + k;
+				const limb_t* const x2 = x + 2 * k;
+				// ones = x0 + x2, minus_ones = x1 zero extended
+				ones[k] = add(ones, x0, k, x2, s);
+				std::copy(x1, x1 + k, minus_ones);
+				minus_ones[k] = 0;
+				const bool negative = abs_sub_n(minus_ones, ones, minus_ones, e);
+				ones[k] += add_n(ones, ones, x1, k);
+				// twos = (x2 * 2 + x1) * 2 + x0
+				std::fill(twos, twos + e, 0);
+				std::copy(x2, x2 + s, twos);
+				lshift_in_place(twos, e, 1);
+				add(twos, twos, e, x1, k);
+				lshift_in_place(twos, e, 1);
+				add(twos, twos, e, x0, k);
+				return negative;
+			};
+			// The value in -1 of a square is never negative
+			const bool square = a == b;
+			const bool a_negative = evaluate(a, pa, ma, qa);
+			const bool vm1_negative = square ? false : a_negative != evaluate(b, pb, mb, qb);
+
+			// Point-wise products, v0 and vinf are placed directly in the result.
+			// A square keeps squaring: the evaluations of b are those of a
+			TaskGroup group(parallel_pool(n));
+			group.run([=] { mul_n(r, a, b, k); });
+			group.run([=] { mul_n(r + 4 * k, a + 2 * k, b + 2 * k, s); });
+			group.run([=] { mul_n(v1, pa, square ? pa : pb, e); });
+			group.run([=] { mul_n(vm1, ma, square ? ma : mb, e); });
+			mul_n(v2, qa, square ? qa : qb, e);
+			group.wait();
+
+			// Copy out c0 and c4 before the result is reused for the accumulation
+			std::vector<limb_t> c0(r, r + 2 * k);
+			std::vector<limb_t> c4(r + 4 * k, r + 4 * k + 2 * s);
+			c4.resize(p, 0);
+
+			// c2 = (v1 + vm1) / 2 - c0 - c4, stored in t
+			// c1 + c3 = (v1 - vm1) / 2, stored in v1
+			if (vm1_negative)
+			{
+				sub_n(t, v1, vm1, p);
+				add_n(v1, v1, vm1, p);
+			}
+			else
+			{
+				add_n(t, v1, vm1, p);
+				sub_n(v1, v1, vm1, p);
+			}
+			rshift(t, t, p, 1);
+			rshift(v1, v1, p, 1);
+			sub(t, t, p, c0.data(), 2 * k);
+			sub_n(t, t, c4.data(), p);
+
+			// c3 = ((v2 - c0 - 4 c2 - 16 c4) / 2 - (c1 + c3)) / 3, stored in v2
+			sub(v2, v2, p, c0.data(), 2 * k);
+			std::copy(t, t + p, vm1);
+			lshift_in_place(vm1, p, 2);
+			sub_n(v2, v2, vm1, p);
+			std::copy(c4.begin(), c4.end(), vm1);
+			lshift_in_place(vm1, p, 4);
+			sub_n(v2, v2, vm1, p);
+			rshift(v2, v2, p, 1);
+			sub_n(v2, v2, v1, p);
+			divexact_by3(v2, p);
+			// c1 = (c1 + c3) - c3, stored in v1
+			sub_n(v1, v1, v2, p);
+
+			// r = c0 + c1 B^k + c2 B^2k + c3 B^3k + c4 B^4k
+			std::fill(r + 2 * k, r + 4 * k, 0);
+			add_at(r, 2 * n, k, v1, p);
+			add_at(r, 2 * n, 2 * k, t, p);
+			add_at(r, 2 * n, 3 * k, v2, p);
+		}
+
+		// r[0..2n) = a[0..n) * b[0..n)
+		void mul_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+		{
+			const BigIntThresholds& thresholds = BigInt::thresholds();
+			if (a == b && n < thresholds.karatsuba_sqr)
+			{
+				sqr_basecase(r, a, n);
+			}
+			else if (a != b && n < thresholds.karatsuba_mul)
+			{
+				mul_basecase(r, a, n, b, n);
+			}
+			else if (n < thresholds.toom3_mul)
+			{
+				std::vector<limb_t> scratch(karatsuba_scratch_size(n));
+				karatsuba(r, a, b, n, scratch.data());
+			}
+			else
+			{
+				toom3(r, a, b, n);
+			}
+		}
+	}
+
+	void mul_basecase(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+	{
+		r[an] = mul_1(r, a, an, b[0]);
+		for (size_t i = 1; i < bn; ++i)
+			r[an + i] = addmul_1(r + i, a, an, b[i]);
+	}
+
+	void sqr_basecase(limb_t* r, const limb_t* a, size_t n)
+	{
+		if (n == 1)
+		{
+			r[0] = mul_wide(a[0], a[0], r[1]);
+			return;
+		}
+		// Cross products a[i] * a[j] with i < j, row by row
+		r[0] = 0;
+		r[n] = mul_1(r + 1, a + 1, n - 1, a[0]);
+		for (size_t i = 1; i + 1 < n; ++i)
+			r[n + i] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+		// Double them and add the squares a[i]^2 on the diagonal
+		r[2 * n - 1] = lshift(r + 1, r + 1, 2 * n - 2, 1);
+		limb_t carry = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			limb_t high;
+			const limb_t low = mul_wide(a[i], a[i], high);
+			r[2 * i] = add_with_carry(r[2 * i], low, carry);
+			r[2 * i + 1] = add_with_carry(r[2 * i + 1], high, carry);
+		}
+		assert(carry == 0);
+	}
+
+	void mul(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+	{
+		assert(an >= bn && bn >= 1);
+		if (a == b && an == bn)
+		{
+			sqr(r, a, an);
+			return;
+		}
+		if (bn < BigInt::thresholds().karatsuba_mul)
+		{
+			mul_basecase(r, a, an, b, bn);
+			return;
+		}
+		if (bn >= BigInt::thresholds().ntt_mul)
+		{
+			const size_t block = BigIntMappedResource::current_mul_block_limbs();
+			if (an > block)
+				mul_blocked(r, a, an, b, bn, block);
+			else
+				mul_ntt(r, a, an, b, bn);
+			return;
+		}
+		if (an == bn)
+		{
+			mul_n(r, a, b, bn);
+			return;
+		}
+		// Unbalanced operands: multiply b by consecutive bn sized blocks of a
+		mul_n(r, a, b, bn);
+		std::vector<limb_t> block(2 * bn);
+		size_t offset = bn;
+		for (; offset + bn <= an; offset += bn)
+		{
+			mul_n(block.data(), a + offset, b, bn);
+			std::fill(r + offset + bn, r + offset + 2 * bn, 0);
+			add(r + offset, r + offset, 2 * bn, block.data(), 2 * bn);
+		}
+		const size_t rest = an - offset;
+		if (rest > 0)
+		{
+			mul(block.data(), b, bn, a + offset, rest);
+			std::fill(r + offset + bn, r + an + bn, 0);
+			add(r + offset, r + offset, bn + rest, block.data(), bn + rest);
+		}
+	}
+
+	void sqr(limb_t* r, const limb_t* a, size_t n)
+	{
+		if (n >= BigInt::thresholds().ntt_mul)
+		{
+			const size_t block = BigIntMappedResource::current_mul_block_limbs();
+			if (n > block)
+				mul_blocked(r, a, n, a, n, block);
+			else
+				sqr_ntt(r, a, n);
+		}
+		else
+		{
+			mul_n(r, a, a, n);
+		}
+	}
+
+	void mul_blocked(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn, size_t block)
+	{
+		const size_t a_blocks = (an + block - 1) / block;
+		const size_t b_blocks = (bn + block - 1) / block;
+		// acc holds the limbs of r from the current diagonal i + j == d up: the sum of its
+		// products and the high part carried from the diagonal below. The extra limb takes
+		// the carries of the sum
+		std::vector<limb_t> acc(2 * block + 1, 0);
+		std::vector<limb_t> product(2 * block);
+		for (size_t d = 0; d < a_blocks + b_blocks - 1; ++d)
+		{
+			const size_t first = d >= b_blocks ? d - b_blocks + 1 : 0;
+			const size_t last = std::min(d, a_blocks - 1);
+			for (size_t i = first; i <= last; ++i)
+			{
+				const limb_t* const x = a + i * block;
+				const limb_t* const y = b + (d - i) * block;
+				const size_t xn = std::min(block, an - i * block);
+				const size_t yn = std::min(block, bn - (d - i) * block);
+				if (xn >= yn)
+					mul(product.data(), x, xn, y, yn);
+				else
+					mul(product.data(), y, yn, x, xn);
+				const limb_t carry = add(acc.data(), acc.data(), acc.size(), product.data(), xn + yn);
+				assert(carry == 0);
+				(void)carry;
+			}
+			// The lowest block is final, all of acc after the last diagonal
+			const size_t offset = d * block;
+			const size_t done = d + 2 < a_blocks + b_blocks ? block : an + bn - offset;
+			std::copy(acc.begin(), acc.begin() + done, r + offset);
+			std::copy(acc.begin() + block, acc.end(), acc.begin());
+			std::fill(acc.end() - block, acc.end(), 0);
+		}
+	}
+}
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntLimbs.h"
+#include "include/BigIntThreadPool.h"
+
+/*
+ * Quasi-linear multiplication through number theoretic transforms.
+ * Every limb is one coefficient, the cyclic convolution is computed modulo three
+ * primes p = c * 2^46 + 1 below 2^62 and the coefficients are rebuilt with the
+ * Chinese remainder theorem (Garner). Three such primes hold any coefficient
+ * n * (2^64 - 1)^2 for transform lengths up to 2^46.
+ * The modular products use Montgomery reduction with R = 2^64: the data stays in
+ * normal form while the twiddle factors and constants are kept in Montgomery form.
+ * Inside the transforms the values are only reduced to [0, 2p), which fits since
+ * 4p < 2^64, and are fully reduced once at the end.
+ * With a thread pool installed, the three primes, the transforms of the two
+ * operands and the halves of every large transform run as parallel tasks.
+ */
+namespace bigint_detail
+{
+	namespace
+	{
+		constexpr unsigned int MAX_LOG_LENGTH = 46;
+		constexpr int PRIMES = 3;
+
+		struct NttPrime
+		{
+			limb_t p;
+			limb_t generator;
+			// p^-1 mod 2^64
+			limb_t p_inverse;
+			// 2^128 mod p, converts a value to Montgomery form
+			limb_t r2;
+
+			// a * b * 2^-64 mod p in [0, 2p), requires a * b < p * 2^64
+			limb_t mont_mul_lazy(limb_t a, limb_t b) const
+			{
+				limb_t high;
+				const limb_t low = mul_wide(a, b, high);
+				limb_t m_high;
+				mul_wide(low * p_inverse, p, m_high);
+				// a * b - m * p is a multiple of 2^64, only the high words are left
+				return high - m_high + p;
+			}
+			// a * b * 2^-64 mod p in [0, p), requires a * b < p * 2^64
+			limb_t mont_mul(limb_t a, limb_t b) const
+			{
+				const limb_t result = mont_mul_lazy(a, b);
+				return result >= p ? result - p : result;
+			}
+			limb_t to_mont(limb_t a) const
+			{
+				return mont_mul(a, r2);
+			}
+			limb_t add(limb_t a, limb_t b) const
+			{
+				const limb_t sum = a + b;
+				return sum >= p ? sum - p : sum;
+			}
+			limb_t sub(limb_t a, limb_t b) const
+			{
+				return a >= b ? a - b : a - b + p;
+			}
+			// base^exponent in Montgomery form, base in Montgomery form
+			limb_t mont_pow(limb_t base, limb_t exponent) const
+			{
+				limb_t result = to_mont(1);
+				while (exponent > 0)
+				{
+					if (exponent & 1)
+						result = mont_mul(result, base);
+					base = mont_mul(base, base);
+					exponent >>= 1;
+				}
+				return result;
+			}
+			limb_t mont_inverse(limb_t a) const
+			{
+				return mont_pow(a, p - 2);
+			}
+		};
+
+		NttPrime make_prime(limb_t p, limb_t generator)
+		{
+			NttPrime prime{ p, generator, p, 0 };
+			// Newton iteration, every step doubles the number of correct low bits
+			for (int i = 0; i < 6; ++i)
+				prime.p_inverse *= 2 - p * prime.p_inverse;
+			// 2^128 mod p = (2^64 mod p)^2 mod p
+			const limb_t r = (0 - p) % p;
+			limb_t high;
+			const limb_t low = mul_wide(r, r, high);
+			div_wide(high, low, p, prime.r2);
+			return prime;
+		}
+
+		struct NttContext
+		{
+			NttPrime primes[PRIMES];
+			// Garner constants in Montgomery form: p0^-1 mod p1, p0^-1 mod p2, p1^-1 mod p2
+			limb_t p0_inverse_mod_p1;
+			limb_t p0_inverse_mod_p2;
+			limb_t p1_inverse_mod_p2;
+			// p0 * p1 as a two limb value
+			limb_t p0p1_low;
+			limb_t p0p1_high;
+
+			NttContext()
+				: primes{ make_prime(0x3FFFC00000000001ull, 11), make_prime(0x3FFAC00000000001ull, 3), make_prime(0x3FEBC00000000001ull, 3) }
+			{
+				const NttPrime& q1 = primes[1];
+				const NttPrime& q2 = primes[2];
+				p0_inverse_mod_p1 = q1.mont_inverse(q1.to_mont(primes[0].p % q1.p));
+				p0_inverse_mod_p2 = q2.mont_inverse(q2.to_mont(primes[0].p % q2.p));
+				p1_inverse_mod_p2 = q2.mont_inverse(q2.to_mont(q1.p % q2.p));
+				p0p1_low = mul_wide(primes[0].p, q1.p, p0p1_high);
+			}
+		};
+
+		const NttContext& context()
+		{
+			static const NttContext instance;
+			return instance;
+		}
+
+		// Twiddle factors of every butterfly stage in Montgomery form: the stage joining
+		// blocks of `half` values reads the powers of its 2 * half-th root of unity
+		// from roots[half .. 2 * half)
+		std::vector<limb_t> twiddles(const NttPrime& prime, size_t n, bool inverse)
+		{
+			unsigned int log_n = 0;
+			while ((size_t(1) << log_n) < n)
+				++log_n;
+			limb_t root = prime.mont_pow(prime.to_mont(prime.generator), (prime.p - 1) >> log_n);
+			if (inverse)
+				root = prime.mont_inverse(root);
+			std::vector<limb_t> roots(std::max<size_t>(n, 2));
+			const size_t top = roots.size() / 2;
+			roots[top] = prime.to_mont(1);
+			for (size_t j = 1; j < top; ++j)
+				roots[top + j] = prime.mont_mul(roots[top + j - 1], root);
+			for (size_t half = top / 2; half >= 1; half /= 2)
+			{
+				for (size_t j = 0; j < half; ++j)
+					roots[half + j] = roots[2 * half + 2 * j];
+			}
+			return roots;
+		}
+
+		// Butterflies [begin, end) of a forward stage on the block lo[0..2 half)
+		void forward_butterflies(const NttPrime& prime, limb_t* lo, size_t half, const limb_t* w, size_t begin, size_t end)
+		{
+			const limb_t twice_p = 2 * prime.p;
+			limb_t* const hi = lo + half;
+			for (size_t j = begin; j < end; ++j)
+			{
+				const limb_t u = lo[j];
+				const limb_t v = hi[j];
+				const limb_t sum = u + v;
+				lo[j] = sum >= twice_p ? sum - twice_p : sum;
+				hi[j] = prime.mont_mul_lazy(u - v + twice_p, w[j]);
+			}
+		}
+
+		// Butterflies [begin, end) of an inverse stage on the block lo[0..2 half)
+		void inverse_butterflies(const NttPrime& prime, limb_t* lo, size_t half, const limb_t* w, size_t begin, size_t end)
+		{
+			const limb_t twice_p = 2 * prime.p;
+			limb_t* const hi = lo + half;
+			for (size_t j = begin; j < end; ++j)
+			{
+				const limb_t u = lo[j];
+				const limb_t v = prime.mont_mul_lazy(hi[j], w[j]);
+				const limb_t sum = u + v;
+				const limb_t diff = u - v + twice_p;
+				lo[j] = sum >= twice_p ? sum - twice_p : sum;
+				hi[j] = diff >= twice_p ? diff - twice_p : diff;
+			}
+		}
+
+		// Calls butterflies(begin, end) over [0, half) in chunks spread over the pool
+		template <typename Butterflies>
+		void parallel_butterflies(BigIntThreadPool* pool, size_t half, Butterflies butterflies)
+		{
+			const size_t chunk = std::max<size_t>(half / pool->size(), BigInt::thresholds().parallel_mul);
+			TaskGroup group(pool);
+			for (size_t begin = chunk; begin < half; begin += chunk)
+				group.run([=] { butterflies(begin, std::min(begin + chunk, half)); });
+			butterflies(0, std::min(chunk, half));
+			group.wait();
+		}
+
+		// Decimation in frequency: natural order input, bit reversed output. Values in [0, 2p)
+		void forward(const NttPrime& prime, limb_t* x, size_t n, const std::vector<limb_t>& roots)
+		{
+			BigIntThreadPool* const pool = n >= 2 ? parallel_pool(n) : nullptr;
+			if (pool != nullptr)
+			{
+				// After the first stage the halves are independent transforms of length
+				// n / 2, reading the same twiddle factors
+				const size_t half = n / 2;
+				parallel_butterflies(pool, half, [&prime, x, half, &roots](size_t begin, size_t end)
+				{
+					forward_butterflies(prime, x, half, roots.data() + half, begin, end);
+				});
+				TaskGroup group(pool);
+				group.run([&prime, x, half, &roots] { forward(prime, x + half, half, roots); });
+				forward(prime, x, half, roots);
+				group.wait();
+				return;
+			}
+			for (size_t half = n / 2; half >= 1; half /= 2)
+			{
+				for (size_t start = 0; start < n; start += 2 * half)
+					forward_butterflies(prime, x + start, half, roots.data() + half, 0, half);
+			}
+		}
+
+		// Decimation in time: bit reversed input, natural order output (not scaled by 1/n).
+		// Values in [0, 2p)
+		void inverse(const NttPrime& prime, limb_t* x, size_t n, const std::vector<limb_t>& roots)
+		{
+			BigIntThreadPool* const pool = n >= 2 ? parallel_pool(n) : nullptr;
+			if (pool != nullptr)
+			{
+				// The halves are independent transforms of length n / 2, joined by the last stage
+				const size_t half = n / 2;
+				TaskGroup group(pool);
+				group.run([&prime, x, half, &roots] { inverse(prime, x + half, half, roots); });
+				inverse(prime, x, half, roots);
+				group.wait();
+				parallel_butterflies(pool, half, [&prime, x, half, &roots](size_t begin, size_t end)
+				{
+					inverse_butterflies(prime, x, half, roots.data() + half, begin, end);
+				});
+				return;
+			}
+			for (size_t half = 1; half < n; half *= 2)
+			{
+				for (size_t start = 0; start < n; start += 2 * half)
+					inverse_butterflies(prime, x + start, half, roots.data() + half, 0, half);
+			}
+		}
+
+		// Convolution of a and b (or a with itself if b is null) modulo one prime, the
+		// n residues are left in out
+		void convolve(const NttPrime& prime, const limb_t* a, size_t an, const limb_t* b, size_t bn, size_t n, limb_t* out)
+		{
+			const std::vector<limb_t> roots = twiddles(prime, n, false);
+			std::fill(std::copy(a, a + an, out), out + n, 0);
+			for (size_t i = 0; i < an; ++i)
+				out[i] %= prime.p;
+			if (b != nullptr)
+			{
+				// The transforms of the two operands are independent
+				std::vector<limb_t> other(n, 0);
+				TaskGroup group(parallel_pool(n));
+				group.run([&]
+				{
+					for (size_t i = 0; i < bn; ++i)
+						other[i] = b[i] % prime.p;
+					forward(prime, other.data(), n, roots);
+				});
+				forward(prime, out, n, roots);
+				group.wait();
+				for (size_t i = 0; i < n; ++i)
+					out[i] = prime.mont_mul_lazy(out[i], other[i]);
+			}
+			else
+			{
+				// Squaring needs a single forward transform
+				forward(prime, out, n, roots);
+				for (size_t i = 0; i < n; ++i)
+					out[i] = prime.mont_mul_lazy(out[i], out[i]);
+			}
+			inverse(prime, out, n, twiddles(prime, n, true));
+			// The point-wise products left a 2^-64 factor: scale by 2^64 / n
+			const limb_t scale = prime.to_mont(prime.mont_inverse(prime.to_mont(n % prime.p)));
+			for (size_t i = 0; i < n; ++i)
+				out[i] = prime.mont_mul(out[i], scale);
+		}
+
+		// r[0..rn) = convolution rebuilt from the residues modulo the three primes
+		void reconstruct(limb_t* r, size_t rn, const std::vector<limb_t> (&residues)[PRIMES])
+		{
+			const NttContext& ctx = context();
+			const NttPrime& q0 = ctx.primes[0];
+			const NttPrime& q1 = ctx.primes[1];
+			const NttPrime& q2 = ctx.primes[2];
+			// Three limb running sum of the overlapping coefficients
+			limb_t acc0 = 0, acc1 = 0, acc2 = 0;
+			for (size_t i = 0; i < rn; ++i)
+			{
+				const limb_t r0 = residues[0][i];
+				const limb_t r1 = residues[1][i];
+				const limb_t r2 = residues[2][i];
+				// x = r0 + p0 * t1 + p0 * p1 * t2
+				const limb_t t1 = q1.mont_mul(q1.sub(r1, r0 % q1.p), ctx.p0_inverse_mod_p1);
+				const limb_t t2 = q2.mont_mul(q2.sub(q2.mont_mul(q2.sub(r2, r0 % q2.p), ctx.p0_inverse_mod_p2), t1 % q2.p), ctx.p1_inverse_mod_p2);
+
+				limb_t x1;
+				limb_t x0 = mul_wide(q0.p, t1, x1);
+				limb_t carry = 0;
+				x0 = add_with_carry(x0, r0, carry);
+				x1 += carry;
+				limb_t high_low;
+				const limb_t low_low = mul_wide(ctx.p0p1_low, t2, high_low);
+				limb_t x2;
+				const limb_t low_high = mul_wide(ctx.p0p1_high, t2, x2);
+				carry = 0;
+				x1 = add_with_carry(x1, low_high, carry);
+				x2 += carry;
+				carry = 0;
+				x0 = add_with_carry(x0, low_low, carry);
+				x1 = add_with_carry(x1, high_low, carry);
+				x2 += carry;
+
+				carry = 0;
+				acc0 = add_with_carry(acc0, x0, carry);
+				acc1 = add_with_carry(acc1, x1, carry);
+				acc2 = add_with_carry(acc2, x2, carry);
+				r[i] = acc0;
+				acc0 = acc1;
+				acc1 = acc2;
+				acc2 = carry;
+			}
+			assert(acc0 == 0 && acc1 == 0 && acc2 == 0);
+		}
+
+		void multiply(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+		{
+			const size_t rn = an + bn;
+			size_t n = 1;
+			while (n < rn)
+				n *= 2;
+			if (n > (size_t(1) << MAX_LOG_LENGTH))
+				throw std::length_error("BigInt operands are too large for the NTT multiplication");
+			const NttContext& ctx = context();
+			std::vector<limb_t> residues[PRIMES];
+			TaskGroup group(parallel_pool(n));
+			for (int k = 0; k < PRIMES; ++k)
+			{
+				residues[k].resize(n);
+				group.run([&, k] { convolve(ctx.primes[k], a, an, b, bn, n, residues[k].data()); });
+			}
+			group.wait();
+			reconstruct(r, rn, residues);
+		}
+	}
+
+	void mul_ntt(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+	{
+		multiply(r, a, an, b, bn);
+	}
+
+	void sqr_ntt(limb_t* r, const limb_t* a, size_t n)
+	{
+		multiply(r, a, n, nullptr, n);
+	}
+}
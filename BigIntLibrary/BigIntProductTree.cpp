@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntProductTree.h"
+#include "include/BigIntThreadPool.h"
+
+namespace
+{
+	// Calls body(i) for every i in [0, count), in one chunk per thread of the pool
+	template <typename Body>
+	void for_nodes(BigIntThreadPool* pool, size_t count, Body body)
+	{
+		const size_t chunks = pool != nullptr ? std::min(pool->size(), count) : 1;
+		bigint_detail::TaskGroup group(chunks > 1 ? pool : nullptr);
+		for (size_t k = 1; k < chunks; ++k)
+		{
+			group.run([=]
+			{
+				for (size_t i = count * k / chunks; i < count * (k + 1) / chunks; ++i)
+					body(i);
+			});
+		}
+		for (size_t i = 0; i < count / chunks; ++i)
+			body(i);
+		group.wait();
+	}
+
+	// x mod m in [0, m)
+	BigInt residue(const BigInt& x, const BigInt& m)
+	{
+		BigInt r = x % m;
+		if (r < 0)
+			r += m;
+		return r;
+	}
+}
+
+ProductTree::ProductTree(std::vector<BigInt> moduli)
+{
+	for (const BigInt& modulus : moduli)
+	{
+		if (!modulus.is_positive() || modulus.is_zero())
+		{
+			throw std::domain_error("Math error: the moduli must be positive\n");
+		}
+	}
+	m_levels.push_back(std::move(moduli));
+	// Every level holds about the digits of the root, whose size decides the parallelism
+	size_t digits = 0;
+	for (const BigInt& modulus : m_levels.front())
+		digits += modulus.num_digits();
+	BigIntThreadPool* const pool = bigint_detail::parallel_pool(digits);
+	while (m_levels.back().size() > 1)
+	{
+		const std::vector<BigInt>& below = m_levels.back();
+		// An odd node out moves up unchanged
+		std::vector<BigInt> level((below.size() + 1) / 2);
+		for_nodes(pool, level.size(), [&](size_t i)
+		{
+			level[i] = 2 * i + 1 < below.size() ? below[2 * i] * below[2 * i + 1] : below[2 * i];
+		});
+		m_levels.push_back(std::move(level));
+	}
+}
+
+const BigInt& ProductTree::product() const
+{
+	static const BigInt one = 1;
+	return size() == 0 ? one : m_levels.back().front();
+}
+
+std::vector<BigInt> ProductTree::remainders(const BigInt& x) const
+{
+	return descend(x, false);
+}
+
+std::vector<BigInt> ProductTree::descend(const BigInt& x, bool squares) const
+{
+	if (size() == 0)
+		return std::vector<BigInt>();
+	const auto modulus = [squares](const BigInt& node)
+	{
+		return squares ? node * node : node;
+	};
+	BigIntThreadPool* const pool = bigint_detail::parallel_pool(product().num_digits());
+	std::vector<BigInt> above(1, residue(x, modulus(product())));
+	for (size_t k = m_levels.size() - 1; k-- > 0;)
+	{
+		const std::vector<BigInt>& level = m_levels[k];
+		std::vector<BigInt> below(level.size());
+		for_nodes(pool, level.size(), [&](size_t i)
+		{
+			// The odd node out already holds the remainder of its copy above
+			if (i % 2 == 0 && i + 1 == level.size())
+				below[i] = std::move(above[i / 2]);
+			else
+				below[i] = residue(above[i / 2], modulus(level[i]));
+		});
+		above = std::move(below);
+	}
+	return above;
+}
+
+std::vector<BigInt> batch_gcd(const std::vector<BigInt>& moduli)
+{
+	const ProductTree tree(moduli);
+	std::vector<BigInt> result = tree.descend(tree.product(), true);
+	const std::vector<BigInt>& leaves = tree.moduli();
+	for_nodes(bigint_detail::parallel_pool(tree.product().num_digits()), result.size(), [&](size_t i)
+	{
+		// m divides the product P, so (P mod m^2) / m == (P / m) mod m
+		result[i] = gcd(leaves[i], result[i] / leaves[i]);
+	});
+	return result;
+}
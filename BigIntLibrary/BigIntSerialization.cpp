@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "include/BigInt.h"
+#include "include/BigIntSerialization.h"
+
+namespace
+{
+	// A 64 bit header takes 10 bytes of 7 bits at most
+	constexpr size_t MAX_HEADER_BYTES = 10;
+
+	[[noreturn]] void malformed()
+	{
+		throw std::invalid_argument("Malformed or truncated BigInt encoding");
+	}
+
+	uint64_t header_of(const BigInt& value, size_t& bytes)
+	{
+		bytes = value.byte_size();
+		return static_cast<uint64_t>(bytes) * 2 + (value < 0 ? 1 : 0);
+	}
+
+	size_t header_size(uint64_t header)
+	{
+		size_t size = 1;
+		for (; header >= 0x80; header >>= 7)
+			++size;
+		return size;
+	}
+
+	// Reads the header at data[0..size), stores the magnitude bytes and the sign.
+	// Returns the header bytes, 0 when the header does not end within size
+	size_t parse_header(const std::byte* data, size_t size, size_t& bytes, bool& negative)
+	{
+		uint64_t header = 0;
+		for (size_t i = 0; i < size && i < MAX_HEADER_BYTES; ++i)
+		{
+			const uint64_t byte = static_cast<uint64_t>(data[i]);
+			// The last byte brings the 64th bit only
+			if (i + 1 == MAX_HEADER_BYTES && byte > 1)
+				malformed();
+			header |= (byte & 0x7F) << (7 * i);
+			if ((byte & 0x80) == 0)
+			{
+				// The size of the whole encoding must fit in a size_t
+				if ((header >> 1) > std::numeric_limits<size_t>::max() - MAX_HEADER_BYTES)
+					malformed();
+				bytes = static_cast<size_t>(header >> 1);
+				negative = (header & 1) != 0;
+				return i + 1;
+			}
+		}
+		if (size >= MAX_HEADER_BYTES)
+			malformed();
+		return 0;
+	}
+}
+
+#pragma region writer
+BigIntWriter::BigIntWriter(std::ostream& out, size_t buffer_bytes)
+	: m_out(out), m_buffer(std::max<size_t>(buffer_bytes, 1)), m_used(0)
+{
+
+}
+
+BigIntWriter::~BigIntWriter()
+{
+	try
+	{
+		flush();
+	}
+	catch (...)
+	{
+	}
+}
+
+void BigIntWriter::write(const BigInt& value)
+{
+	const size_t size = encoded_size(value);
+	if (m_used + size > m_buffer.size())
+	{
+		flush();
+		// A value larger than the buffer grows it
+		if (size > m_buffer.size())
+			m_buffer.resize(size);
+	}
+	m_used += encode(value, m_buffer.data() + m_used);
+}
+
+void BigIntWriter::write(const BigInt* values, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		write(values[i]);
+}
+
+void BigIntWriter::write(const std::vector<BigInt>& values)
+{
+	write(values.data(), values.size());
+}
+
+void BigIntWriter::flush()
+{
+	if (m_used > 0)
+	{
+		m_out.write(reinterpret_cast<const char*>(m_buffer.data()), m_used);
+		m_used = 0;
+	}
+	m_out.flush();
+	if (!m_out)
+	{
+		throw std::runtime_error("The BigInt encodings could not be written to the stream");
+	}
+}
+
+size_t BigIntWriter::encoded_size(const BigInt& value)
+{
+	size_t bytes = 0;
+	const uint64_t header = header_of(value, bytes);
+	return header_size(header) + bytes;
+}
+
+size_t BigIntWriter::encode(const BigInt& value, std::byte* out)
+{
+	size_t bytes = 0;
+	uint64_t header = header_of(value, bytes);
+	size_t written = 0;
+	for (; header >= 0x80; header >>= 7)
+		out[written++] = static_cast<std::byte>(header | 0x80);
+	out[written++] = static_cast<std::byte>(header);
+	return written + value.to_bytes(out + written, bytes, Endian::little);
+}
+#pragma endregion
+
+#pragma region reader
+BigIntReader::BigIntReader(const std::byte* data, size_t size)
+	: m_in(nullptr), m_data(data), m_size(size), m_position(0)
+{
+
+}
+
+BigIntReader::BigIntReader(std::istream& in, size_t buffer_bytes)
+	: m_in(&in), m_buffer(std::max(buffer_bytes, MAX_HEADER_BYTES)), m_data(m_buffer.data()), m_size(0), m_position(0)
+{
+
+}
+
+bool BigIntReader::next(BigInt& value)
+{
+	const size_t size = next_size();
+	if (size == 0)
+		return false;
+	if (!ensure(size))
+		malformed();
+	m_position += decode(m_data + m_position, size, value);
+	return true;
+}
+
+bool BigIntReader::skip()
+{
+	const size_t size = next_size();
+	if (size == 0)
+		return false;
+	const size_t available = m_size - m_position;
+	if (size <= available)
+	{
+		m_position += size;
+		return true;
+	}
+	if (m_in == nullptr)
+		malformed();
+	// The rest of the value is discarded from the stream, without buffering it
+	size_t rest = size - available;
+	m_position = m_size;
+	while (rest > 0)
+	{
+		const size_t step = std::min<size_t>(rest, std::numeric_limits<std::streamsize>::max());
+		m_in->ignore(static_cast<std::streamsize>(step));
+		const size_t ignored = static_cast<size_t>(m_in->gcount());
+		if (ignored < step)
+			malformed();
+		rest -= ignored;
+	}
+	return true;
+}
+
+size_t BigIntReader::read(BigInt* values, size_t count)
+{
+	size_t i = 0;
+	while (i < count && next(values[i]))
+		++i;
+	return i;
+}
+
+std::vector<BigInt> BigIntReader::read_all()
+{
+	std::vector<BigInt> values;
+	BigInt value;
+	while (next(value))
+		values.push_back(std::move(value));
+	return values;
+}
+
+size_t BigIntReader::decode(const std::byte* data, size_t size, BigInt& value)
+{
+	size_t bytes = 0;
+	bool negative = false;
+	const size_t header = parse_header(data, size, bytes, negative);
+	if (header == 0 || size - header < bytes)
+		malformed();
+	value.assign_bytes(data + header, bytes, Endian::little, 1, Endian::little);
+	if (negative && !value.is_zero())
+		value.set_sign(Sign::negative);
+	return header + bytes;
+}
+
+bool BigIntReader::ensure(size_t n)
+{
+	if (m_size - m_position >= n)
+		return true;
+	if (m_in == nullptr)
+		return false;
+	// The bytes left move to the front of the buffer, the stream fills the rest
+	const size_t left = m_size - m_position;
+	std::memmove(m_buffer.data(), m_buffer.data() + m_position, left);
+	m_size = left;
+	m_position = 0;
+	while (m_size < n && *m_in)
+	{
+		// n comes from a header that may be corrupt: the buffer only grows, doubling,
+		// as the bytes arrive
+		if (m_size == m_buffer.size())
+			m_buffer.resize(std::min(n, 2 * m_buffer.size()));
+		m_data = m_buffer.data();
+		m_in->read(reinterpret_cast<char*>(m_buffer.data() + m_size), m_buffer.size() - m_size);
+		m_size += static_cast<size_t>(m_in->gcount());
+	}
+	return m_size >= n;
+}
+
+size_t BigIntReader::next_size()
+{
+	if (!ensure(1))
+		return 0;
+	// As much of the longest header as the data holds
+	ensure(MAX_HEADER_BYTES);
+	size_t bytes = 0;
+	bool negative = false;
+	const size_t header = parse_header(m_data + m_position, m_size - m_position, bytes, negative);
+	if (header == 0)
+		malformed();
+	return header + bytes;
+}
+#pragma endregion
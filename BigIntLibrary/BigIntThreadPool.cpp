@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+#include "include/BigInt.h"
+#include "include/BigIntArena.h"
+#include "include/BigIntStorage.h"
+#include "include/BigIntThreadPool.h"
+
+namespace
+{
+	// Pool and queue of the calling thread when it is a worker
+	thread_local const BigIntThreadPool* t_pool = nullptr;
+	thread_local size_t t_queue = 0;
+}
+
+#pragma region pool
+BigIntThreadPool::BigIntThreadPool(size_t threads)
+	: m_queued(0), m_stop(false)
+{
+	if (threads == 0)
+		threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	for (size_t i = 0; i <= threads; ++i)
+		m_queues.push_back(std::make_unique<Queue>());
+	m_workers.reserve(threads);
+	for (size_t i = 0; i < threads; ++i)
+		m_workers.emplace_back(&BigIntThreadPool::work, this, i);
+}
+
+BigIntThreadPool::~BigIntThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+void BigIntThreadPool::push(Task task)
+{
+	Queue& queue = *m_queues[t_pool == this ? t_queue : m_queues.size() - 1];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	{
+		// Counted under the lock, a worker about to sleep cannot miss the wake up
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		++m_queued;
+	}
+	m_wake.notify_one();
+}
+
+bool BigIntThreadPool::try_pop(Task& task)
+{
+	if (m_queued.load() == 0)
+		return false;
+	const size_t count = m_queues.size();
+	const size_t own = t_pool == this ? t_queue : count - 1;
+	// The own queue from the back, where the latest and smallest tasks are, the
+	// others from the front, where the largest wait
+	for (size_t k = 0; k < count; ++k)
+	{
+		Queue& queue = *m_queues[(own + k) % count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+		if (k == 0)
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		--m_queued;
+		return true;
+	}
+	return false;
+}
+
+bool BigIntThreadPool::try_pop(Task& task, const bigint_detail::TaskGroup* group)
+{
+	if (m_queued.load() == 0)
+		return false;
+	Queue& queue = *m_queues[t_pool == this ? t_queue : m_queues.size() - 1];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	// The threads outside the pool share their queue: skip the tasks of the others
+	for (auto it = queue.tasks.rbegin(); it != queue.tasks.rend(); ++it)
+	{
+		if (it->group != group)
+			continue;
+		task = std::move(*it);
+		queue.tasks.erase(std::next(it).base());
+		--m_queued;
+		return true;
+	}
+	return false;
+}
+
+void BigIntThreadPool::run(Task& task)
+{
+	std::exception_ptr error;
+	try
+	{
+		const BigIntResourceScope scope(*task.resource);
+		task.function();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	// Release the captures before the group can go away
+	task.function = nullptr;
+	task.group->finish(error);
+}
+
+void BigIntThreadPool::work(size_t index)
+{
+	t_pool = this;
+	t_queue = index;
+	Task task{};
+	for (;;)
+	{
+		if (try_pop(task))
+		{
+			run(task);
+			continue;
+		}
+		// Sleep until a task is queued or the pool stops, looking again now and then
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		m_wake.wait_for(lock, std::chrono::milliseconds(100), [this] { return m_stop || m_queued.load() > 0; });
+		// The groups wait for their tasks, none is left when the pool is destroyed
+		if (m_stop)
+			return;
+	}
+}
+#pragma endregion
+
+#pragma region task-group
+BigIntThreadPool* bigint_detail::parallel_pool(size_t n)
+{
+	BigIntThreadPool* const pool = BigInt::thread_pool();
+	return pool != nullptr && n >= BigInt::thresholds().parallel_mul ? pool : nullptr;
+}
+
+bigint_detail::TaskGroup::TaskGroup(BigIntThreadPool* pool)
+	: m_pool(pool), m_pending(0)
+{
+
+}
+
+bigint_detail::TaskGroup::~TaskGroup()
+{
+	join();
+}
+
+void bigint_detail::TaskGroup::run(std::function<void()> function)
+{
+	if (m_pool == nullptr)
+	{
+		function();
+		return;
+	}
+	++m_pending;
+	m_pool->push(BigIntThreadPool::Task{ std::move(function), this, bigint_detail::current_limb_resource() });
+}
+
+void bigint_detail::TaskGroup::wait()
+{
+	join();
+	if (m_error)
+	{
+		const std::exception_ptr error = std::move(m_error);
+		m_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void bigint_detail::TaskGroup::finish(std::exception_ptr error)
+{
+	// Under the lock, the waiting thread cannot see the group done and destroy it
+	// before the notification
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (error && !m_error)
+		m_error = std::move(error);
+	if (m_pending.fetch_sub(1, std::memory_order_release) == 1)
+		m_done.notify_all();
+}
+
+void bigint_detail::TaskGroup::join()
+{
+	// Help instead of blocking: the tasks this group waits for may sit in the queue
+	// of the calling thread. Only those, a task of another thread would take its
+	// digits from the memory resource of this one
+	BigIntThreadPool::Task task{};
+	while (m_pending.load(std::memory_order_acquire) > 0)
+	{
+		if (m_pool->try_pop(task, this))
+		{
+			BigIntThreadPool::run(task);
+			continue;
+		}
+		// The rest run on other threads, finish() wakes this one after the last
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait_for(lock, std::chrono::milliseconds(100), [this] { return m_pending.load(std::memory_order_acquire) == 0; });
+	}
+	// The last finish() may still hold the lock, the group must not go away before
+	const std::lock_guard<std::mutex> lock(m_mutex);
+}
+#pragma endregion
@@ -1,15 +1,31 @@
 #pragma once
+#include <charconv>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
+#include <iosfwd>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "BigIntStorage.h"
 
 #pragma region forward-declarations
 class ostream;
 class istream;
 class vector;
 class string;
+class BigIntThreadPool;
+template <size_t Bits>
+class FixedBigInt;
+namespace bigint_detail
+{
+	class GcdSteps;
+}
 #pragma endregion
 
-#define BIGINT_BASE 256
+// Number of bits stored in every digit (limb) of a BigInt
+#define BIGINT_DIGIT_BITS 64
 
 enum class Sign
 {
@@ -17,34 +33,102 @@ enum class Sign
 	negative
 };
 
+// Order of the words, or of the bytes within a word, in the binary import and export
+enum class Endian
+{
+	little,
+	big,
+	// The order of the host
+	native
+};
+
+// Operand sizes (in digits) at which the arithmetic switches to an asymptotically
+// faster algorithm. The defaults can be calibrated per host through BigInt::set_thresholds
+struct BigIntThresholds
+{
+	// Smallest operand that is multiplied with Karatsuba instead of schoolbook
+	size_t karatsuba_mul = 32;
+	// Smallest operand that is squared with Karatsuba instead of the squaring basecase
+	size_t karatsuba_sqr = 56;
+	// Smallest operand that is multiplied with Toom-Cook 3-way instead of Karatsuba
+	size_t toom3_mul = 256;
+	// Smallest operand that is multiplied through number theoretic transforms
+	size_t ntt_mul = 8192;
+	// Smallest divisor that is divided recursively instead of with schoolbook long division
+	size_t dc_div = 32;
+	// Smallest value that is converted from/to decimal text by divide and conquer
+	size_t dc_radix = 32;
+	// Smallest operand whose gcd is computed with the half-gcd recursion instead of Lehmer steps
+	size_t hgcd = 256;
+	// Smallest operand whose subproducts are spread over the thread pool, when one is installed
+	size_t parallel_mul = 1024;
+};
+
 class BigInt
 {
+	// Work on the digits directly for the Montgomery arithmetic, the fixed width copies
+	// and the batch operations
+	friend class Modulus;
+	friend class ConstantTimeInt;
+	friend class ConstantTimeModulus;
+	friend class BigIntView;
+	friend class BigIntReader;
+	template <size_t Bits>
+	friend class FixedBigInt;
+	friend class ProductTree;
+	friend class bigint_detail::GcdSteps;
+	friend std::vector<BigInt> batch_gcd(const std::vector<BigInt>& moduli);
+	friend BigInt sum(const BigInt* values, size_t count);
+	friend BigInt product(const BigInt* values, size_t count);
+	friend void add(BigInt* result, const BigInt* lhs, const BigInt* rhs, size_t count);
+	friend void mul(BigInt* result, const BigInt* lhs, const BigInt* rhs, size_t count);
 private:
-	typedef uint8_t digit_t;
-	Sign m_sign;
-	std::vector<digit_t> m_digits;
+	typedef uint64_t digit_t;
+	// Values up to 256 bits are stored inline, the sign is packed in the storage header
+	bigint_detail::LimbVector m_digits;
 public:
 #pragma region constructors
 	BigInt();
 	BigInt(long long num);
 	BigInt(const std::string& s);
+	BigInt(const BigInt& other) = default;
+	// Moves never allocate nor throw, so containers of BigInt relocate by moving
+	BigInt(BigInt&& other) noexcept = default;
+	BigInt& operator=(const BigInt& other) = default;
+	BigInt& operator=(BigInt&& other) noexcept = default;
 #pragma endregion
 
 #pragma region input/output
 	//ostream& Print(ostream& os);
+	// Writes the decimal text a piece at a time as it is produced, only a field width
+	// (std::setw) builds the whole text first to pad it
 	friend std::ostream& operator<<(std::ostream& out, const BigInt& big);
-	//istream& operator>>(istream& in, BigInt& big);
+	// Skips the whitespace and reads an optional sign and the decimal digits, stopping at
+	// the first other character. The digits are converted a block at a time as they are
+	// read, the text is never stored whole. Sets failbit and leaves big unchanged when
+	// there are no digits
+	friend std::istream& operator>>(std::istream& in, BigInt& big);
+	// Like std::to_chars: writes the decimal text to [first, last), without terminator.
+	// Returns {last, std::errc::value_too_large} when it does not fit
+	friend std::to_chars_result to_chars(char* first, char* last, const BigInt& value);
+	// Like std::from_chars: parses an optional minus sign and the decimal digits at first.
+	// Returns {first, std::errc::invalid_argument} and leaves value unchanged when there
+	// are no digits
+	friend std::from_chars_result from_chars(const char* first, const char* last, BigInt& value);
 #pragma endregion
 
 #pragma region arithmetic
 private:
-	// This operations are not exposed to the final user, because their
-	// functionality is restricted to single digit operation.
-	const BigInt& operator*=(unsigned int num);
-	friend BigInt operator*(const BigInt&  big, unsigned int num);
-	friend BigInt operator*(unsigned int num, const BigInt& big);
-
-	friend void iterative_subtraction_division(const BigInt& lhs, const BigInt& rhs, BigInt& out_quotient, BigInt& out_reminder);
+	// Not exposed to the final user, because its functionality is restricted to
+	// single digit operation. A named function rather than an operator, so that
+	// small integer operands convert to BigInt and keep their sign (a * -3)
+	const BigInt& mul_digit(digit_t num);
+	// *this += rhs, or *this -= rhs when subtract is set, without copying rhs
+	const BigInt& add_signed(const BigInt& rhs, bool subtract);
+	// *this + rhs for operands of opposite signs, rhs_negative is the sign of the added value
+	const BigInt& subtract_magnitude(const BigInt& rhs, bool rhs_negative);
+	// Compares |*this| with |rhs|, returns -1, 0 or 1
+	int compare_magnitude(const BigInt& rhs) const;
 public:
 	BigInt operator-() const;
 	BigInt operator++(int);
@@ -52,39 +136,92 @@ public:
 	// Returning const reference avoids complex and error prone syntax (++++x) (x+=y++)
 	const BigInt& operator++();
 	const BigInt& operator--();
+	// The overloads taking rvalues reuse the digits of the temporary operand, so a
+	// chained expression like a * b + c * d - e only allocates for the products
 	const BigInt& operator+=(const BigInt& rhs);
 	friend BigInt operator+(const BigInt& lhs, const BigInt& rhs);
+	friend BigInt operator+(BigInt&& lhs, const BigInt& rhs);
+	friend BigInt operator+(const BigInt& lhs, BigInt&& rhs);
+	friend BigInt operator+(BigInt&& lhs, BigInt&& rhs);
 	const BigInt& operator-=(const BigInt& rhs);
 	friend BigInt operator-(const BigInt& lhs, const BigInt& rhs);
+	friend BigInt operator-(BigInt&& lhs, const BigInt& rhs);
+	friend BigInt operator-(const BigInt& lhs, BigInt&& rhs);
+	friend BigInt operator-(BigInt&& lhs, BigInt&& rhs);
 	const BigInt& operator*=(const BigInt& rhs);
 	friend BigInt operator*(const BigInt& lhs, const BigInt& rhs);
+	friend BigInt operator*(BigInt&& lhs, const BigInt& rhs);
+	friend BigInt operator*(const BigInt& lhs, BigInt&& rhs);
+	friend BigInt operator*(BigInt&& lhs, BigInt&& rhs);
+	// Fused multiply-accumulate: *this += lhs * rhs and *this -= lhs * rhs. Small
+	// products are accumulated row by row in the digits of *this, with no temporary
+	const BigInt& addmul(const BigInt& lhs, const BigInt& rhs);
+	const BigInt& submul(const BigInt& lhs, const BigInt& rhs);
 	const BigInt& operator/=(const BigInt& rhs);
 	friend BigInt operator/(const BigInt& lhs, const BigInt& rhs);
 	const BigInt& operator%=(const BigInt& rhs);
 	friend BigInt operator%(const BigInt& lhs, const BigInt& rhs);
+	// Quotient and remainder of a single division, the same values returned by / and %
+	friend std::pair<BigInt, BigInt> divmod(const BigInt& lhs, const BigInt& rhs);
 
 	friend BigInt pow(const BigInt& base, const BigInt& exponent);
 	friend BigInt pow(const BigInt& base, int exponent);
+
+	// Greatest common divisor, never negative: gcd(0, 0) == 0
+	friend BigInt gcd(const BigInt& a, const BigInt& b);
+	// Least common multiple, never negative: 0 when an operand is 0
+	friend BigInt lcm(const BigInt& a, const BigInt& b);
+	// Returns (g, x, y) with a * x + b * y == g == gcd(a, b)
+	friend std::tuple<BigInt, BigInt, BigInt> extended_gcd(const BigInt& a, const BigInt& b);
+	// x in [0, m) with a * x == 1 mod m. Throws std::domain_error unless m is positive and
+	// coprime with a
+	friend BigInt modinv(const BigInt& a, const BigInt& m);
 #pragma endregion
 
 #pragma region bitwise-operators
 private:
-	void perform_bitwise(const BigInt& rhs, std::function<uint8_t(uint8_t, uint8_t)>);
+	enum class Bitwise
+	{
+		and_op,
+		or_op,
+		xor_op
+	};
+	// *this = *this op rhs on the infinite two's complement representations, like the
+	// built in integers: negative values behave as if extended with one bits forever
+	void perform_bitwise(const BigInt& rhs, Bitwise operation);
+	// *this = ~*this in place
+	void complement();
 public:
+	// ~x == -x - 1, the rvalue overload reuses the digits of the temporary
+	BigInt operator~() const &;
+	BigInt operator~() &&;
 	const BigInt& operator&=(const BigInt& rhs);
 	friend BigInt operator&(const BigInt& lhs, const BigInt& rhs);
+	friend BigInt operator&(BigInt&& lhs, const BigInt& rhs);
+	friend BigInt operator&(const BigInt& lhs, BigInt&& rhs);
+	friend BigInt operator&(BigInt&& lhs, BigInt&& rhs);
 	const BigInt& operator|=(const BigInt& rhs);
 	friend BigInt operator|(const BigInt& lhs, const BigInt& rhs);
+	friend BigInt operator|(BigInt&& lhs, const BigInt& rhs);
+	friend BigInt operator|(const BigInt& lhs, BigInt&& rhs);
+	friend BigInt operator|(BigInt&& lhs, BigInt&& rhs);
 	const BigInt& operator^=(const BigInt& rhs);
 	friend BigInt operator^(const BigInt& lhs, const BigInt& rhs);
+	friend BigInt operator^(BigInt&& lhs, const BigInt& rhs);
+	friend BigInt operator^(const BigInt& lhs, BigInt&& rhs);
+	friend BigInt operator^(BigInt&& lhs, BigInt&& rhs);
 
 	BigInt& operator<<=(std::size_t pos);
 	BigInt operator<<(std::size_t pos) const;
+	// Arithmetic shift: rounds towards negative infinity, so -1 >> n == -1
 	BigInt& operator>>=(std::size_t pos);
 	BigInt operator>>(std::size_t pos) const;
 #pragma endregion 
 
 #pragma region comparison
+// Returns -1, 0 or 1 as lhs is less than, equal to or greater than rhs. The ordering
+// operators below derive from it
+friend int compare(const BigInt& lhs, const BigInt& rhs);
 friend bool operator==(const BigInt& lhs, const BigInt& rhs);
 friend bool operator!=(const BigInt& lhs, const BigInt& rhs);
 friend bool operator<(const BigInt& lhs, const BigInt& rhs);
@@ -97,8 +234,53 @@ friend bool operator>=(const BigInt& lhs, const BigInt& rhs);
 	operator std::string() const;
 #pragma endregion
 
+#pragma region binary-input/output
+	// The magnitude as words of word_size bytes, like mpz_import and mpz_export: word_order
+	// sorts the words (big: the most significant first) and byte_order the bytes of a word.
+	// The sign is not stored, from_bytes gives a value >= 0. The defaults are one big
+	// endian byte string. Throws std::invalid_argument unless word_size divides size
+	static BigInt from_bytes(const std::byte* data, size_t size, Endian word_order = Endian::big, size_t word_size = 1, Endian byte_order = Endian::big);
+	// Bytes written by to_bytes: the fewest whole words holding the magnitude, 0 for zero.
+	// Throws std::invalid_argument when word_size is 0
+	size_t byte_size(size_t word_size = 1) const;
+	// Writes the magnitude to out and returns byte_size(word_size). Throws
+	// std::length_error when capacity is smaller. See BigIntView.h to read the limbs in place
+	size_t to_bytes(std::byte* out, size_t capacity, Endian word_order = Endian::big, size_t word_size = 1, Endian byte_order = Endian::big) const;
+#pragma endregion
+
+#pragma region tuning
+	static const BigIntThresholds& thresholds();
+	// Not thread safe: meant to be called once at startup, before any computation
+	static void set_thresholds(const BigIntThresholds& thresholds);
+	// Pool running the large multiplications in parallel, nullptr (the default) keeps
+	// every operation on the calling thread. Process wide
+	static BigIntThreadPool* thread_pool();
+	// Installs a pool (nullptr restores the serial arithmetic) and returns the previous
+	// one. See BigIntThreadPool.h
+	static BigIntThreadPool* set_thread_pool(BigIntThreadPool* pool);
+#pragma endregion
+
+#pragma region memory
+	// Resource that provides the digits of the values outgrowing the inline storage,
+	// per thread. Defaults to std::pmr::get_default_resource()
+	static std::pmr::memory_resource* memory_resource();
+	// Installs a resource for the calling thread (nullptr restores the default) and
+	// returns the previous one. See BigIntArena.h for a scoped installer
+	static std::pmr::memory_resource* set_memory_resource(std::pmr::memory_resource* resource);
+#pragma endregion
+
 private:
 	const BigInt& remove_leading_zeros();
+	// *this += |lhs| * |rhs|, or -= when negative is set
+	const BigInt& accumulate_product(const BigInt& lhs, const BigInt& rhs, bool negative);
+	// Magnitude of the decimal digits [first, last), no sign nor validation
+	static BigInt from_decimal(const char* first, const char* last);
+	// Writes the decimal digits of the magnitude to sink, zero padded to width, most
+	// significant first. Sink has write(const char*, size_t) and zeros(size_t)
+	template <class Sink>
+	void to_decimal(Sink& sink, size_t width) const;
+	// from_bytes into *this, reusing its digits
+	void assign_bytes(const std::byte* data, size_t size, Endian word_order, size_t word_size, Endian byte_order);
 #pragma region getters/setters
 	// These functions are intended to be modified in case of future refactoring
 	// All these functions are defined here to be inline
@@ -106,25 +288,37 @@ private:
 	{
 		return m_digits.size();
 	}
-	unsigned int get_digit(int k) const
+	digit_t get_digit(size_t k) const
 	{
 		return k < num_digits() ? m_digits[k] : 0;
 	}
-	void change_digit(int k, int value)
+	void change_digit(size_t k, digit_t value)
 	{
 		m_digits[k] = value;
 	}
-	void add_digit(int value)
+	void add_digit(digit_t value)
 	{
 		m_digits.push_back(value);
 	}
+	Sign sign() const
+	{
+		return m_digits.flag() ? Sign::negative : Sign::positive;
+	}
+	void set_sign(Sign sign)
+	{
+		m_digits.set_flag(sign == Sign::negative);
+	}
+	bool is_zero() const
+	{
+		return num_digits() == 1 && m_digits[0] == 0;
+	}
 	bool is_positive() const
 	{
-		return m_sign == Sign::positive;
+		return sign() == Sign::positive;
 	}
 	bool is_negative() const
 	{
-		return m_sign == Sign::negative;
+		return sign() == Sign::negative;
 	}
 #pragma endregion 
 };
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <memory_resource>
+
+/*
+ * Bump allocation for the digits of short lived BigInt values.
+ * A BigIntArena hands out memory from large chunks by moving a pointer forward,
+ * deallocations are free and reset() makes the whole arena available again in
+ * constant time, keeping the chunks for the next round. An arena is meant to be
+ * used by one thread: BigIntArena::thread_local_instance() returns the arena of
+ * the calling thread, so batch workers never contend on the global heap. The
+ * allocations still take a lock, because the tasks of the thread pool allocate from
+ * the resource of the thread that started them (see BigIntThreadPool.h).
+ *
+ *	BigIntArena& arena = BigIntArena::thread_local_instance();
+ *	{
+ *		BigIntResourceScope scope(arena);
+ *		// BigInt temporaries created here take their digits from the arena
+ *	}
+ *	arena.reset();
+ *
+ * Every value whose digits live in the arena must be destroyed (or copied out,
+ * after the scope is closed) before reset() is called, and no computation may be
+ * running on it.
+ */
+class BigIntArena : public std::pmr::memory_resource
+{
+public:
+	// Chunks hold at least chunk_bytes and are requested from upstream
+	explicit BigIntArena(size_t chunk_bytes = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+	BigIntArena(const BigIntArena&) = delete;
+	BigIntArena& operator=(const BigIntArena&) = delete;
+	~BigIntArena() override;
+
+	// Releases every allocation at once, the chunks are kept for reuse
+	void reset();
+	// Bytes handed out since the last reset
+	size_t bytes_allocated() const
+	{
+		return m_allocated;
+	}
+
+	static BigIntArena& thread_local_instance();
+
+private:
+	struct Chunk
+	{
+		Chunk* next;
+		size_t size;
+	};
+
+	std::pmr::memory_resource* m_upstream;
+	size_t m_chunk_bytes;
+	// Chunks in allocation order, the ones after m_current are free
+	Chunk* m_first;
+	Chunk* m_current;
+	char* m_position;
+	char* m_end;
+	size_t m_allocated;
+	// Spin lock of the allocations, held for a few instructions and uncontended but
+	// for the parallel tasks of the pool
+	std::atomic_flag m_busy = ATOMIC_FLAG_INIT;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+	// Makes the next chunk (reused or new) able to hold bytes the current one
+	void next_chunk(size_t bytes, size_t alignment);
+};
+
+// Installs a memory resource for the BigInt values grown on the calling thread and
+// restores the previous one when it goes out of scope
+class BigIntResourceScope
+{
+public:
+	explicit BigIntResourceScope(std::pmr::memory_resource& resource);
+	BigIntResourceScope(const BigIntResourceScope&) = delete;
+	BigIntResourceScope& operator=(const BigIntResourceScope&) = delete;
+	~BigIntResourceScope();
+
+private:
+	std::pmr::memory_resource* m_previous;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "BigInt.h"
+
+/*
+ * Batch operations over arrays of BigInt, given as a pointer and a count (or as a
+ * std::vector). They allocate their output once and split the work over the
+ * thread pool when one is installed (see BigIntThreadPool.h).
+ */
+
+// Sum of values[0..count), 0 for an empty range. Carry-save accumulation: the carries
+// are counted per digit and propagated once at the end
+BigInt sum(const BigInt* values, size_t count);
+BigInt sum(const std::vector<BigInt>& values);
+// Product of values[0..count), 1 for an empty range. Balanced product tree: the
+// halves hold about the same number of digits
+BigInt product(const BigInt* values, size_t count);
+BigInt product(const std::vector<BigInt>& values);
+
+// Elementwise result[i] = lhs[i] + rhs[i], result may alias lhs or rhs
+void add(BigInt* result, const BigInt* lhs, const BigInt* rhs, size_t count);
+// Throws std::invalid_argument unless lhs and rhs have the same size
+std::vector<BigInt> add(const std::vector<BigInt>& lhs, const std::vector<BigInt>& rhs);
+// Elementwise result[i] = lhs[i] * rhs[i], result may alias lhs or rhs
+void mul(BigInt* result, const BigInt* lhs, const BigInt* rhs, size_t count);
+// Throws std::invalid_argument unless lhs and rhs have the same size
+std::vector<BigInt> mul(const std::vector<BigInt>& lhs, const std::vector<BigInt>& rhs);
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "BigInt.h"
+#include "BigIntStorage.h"
+
+/*
+ * Constant time arithmetic for secret values (private keys, nonces, blinding factors).
+ * A ConstantTimeInt is an unsigned integer with a number of limbs fixed when it is
+ * built: the leading zero limbs are kept, so its width never depends on its value.
+ * For given widths, the operations of the constant_time namespace and of
+ * ConstantTimeModulus run the same instructions and touch the same memory whatever
+ * the values: no branch, loop bound nor memory index depends on a limb. Only the
+ * widths, which are public, may change the running time.
+ * The conversions from and to BigInt are not constant time, they are meant for
+ * the boundaries of the secret computation (loading a key, printing a result).
+ */
+class ConstantTimeInt
+{
+public:
+	typedef uint64_t limb_t;
+
+	// Zero on the given number of limbs, throws std::invalid_argument when limbs is 0
+	explicit ConstantTimeInt(size_t limbs);
+	// Throws std::domain_error for negative values and std::length_error when the value
+	// does not fit the given number of limbs
+	ConstantTimeInt(const BigInt& value, size_t limbs);
+
+	size_t size() const
+	{
+		return m_limbs.size();
+	}
+	limb_t* data()
+	{
+		return m_limbs.data();
+	}
+	const limb_t* data() const
+	{
+		return m_limbs.data();
+	}
+	BigInt to_bigint() const;
+
+private:
+	bigint_detail::LimbVector m_limbs;
+};
+
+namespace constant_time
+{
+	typedef ConstantTimeInt::limb_t limb_t;
+
+	// The operands of a function must have the same width (std::invalid_argument otherwise),
+	// but for mul. result may alias the operands.
+
+	// result = lhs + rhs mod 2^(64 size), returns the carry out (0 or 1)
+	limb_t add(ConstantTimeInt& result, const ConstantTimeInt& lhs, const ConstantTimeInt& rhs);
+	// result = lhs - rhs mod 2^(64 size), returns the borrow out (0 or 1)
+	limb_t sub(ConstantTimeInt& result, const ConstantTimeInt& lhs, const ConstantTimeInt& rhs);
+	// Full product, lhs.size() + rhs.size() limbs wide
+	ConstantTimeInt mul(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs);
+	// Returns -1, 0 or 1
+	int compare(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs);
+	bool equal(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs);
+	// Swaps the values when condition is 1, leaves them when it is 0
+	void conditional_swap(ConstantTimeInt& lhs, ConstantTimeInt& rhs, limb_t condition);
+}
+
+/*
+ * Montgomery arithmetic modulo a public odd modulus, in constant time for the
+ * secret operands. The values are ConstantTimeInt as wide as the modulus; the
+ * Montgomery form of x is x * 2^(64 size) mod m.
+ */
+class ConstantTimeModulus
+{
+public:
+	typedef uint64_t limb_t;
+
+	// Throws std::domain_error unless modulus is odd and greater than 1
+	explicit ConstantTimeModulus(const BigInt& modulus);
+
+	size_t size() const
+	{
+		return m_modulus.size();
+	}
+	const ConstantTimeInt& value() const
+	{
+		return m_modulus;
+	}
+	// Montgomery form of x mod m, any x of size() limbs
+	ConstantTimeInt to_montgomery(const ConstantTimeInt& x) const;
+	// Leaves the Montgomery form, the result is in [0, m)
+	ConstantTimeInt from_montgomery(const ConstantTimeInt& x) const;
+	// lhs * rhs * 2^(-64 size) mod m, requires lhs and rhs in [0, m)
+	ConstantTimeInt montgomery_mul(const ConstantTimeInt& lhs, const ConstantTimeInt& rhs) const;
+	// base^exponent mod m with the usual (not Montgomery) representation. Fixed windows
+	// (4 to 6 bits, by exponent width) over all the limbs of the exponent, so only its
+	// width is public
+	ConstantTimeInt pow(const ConstantTimeInt& base, const ConstantTimeInt& exponent) const;
+
+private:
+	ConstantTimeInt m_modulus;
+	limb_t m_inverse;
+	// 2^(128 size) mod m, moves a value into the Montgomery form
+	ConstantTimeInt m_r2;
+	// 2^(64 size) mod m, the Montgomery form of one
+	ConstantTimeInt m_one;
+
+	// Limbs of the scratch of the raw montgomery_mul
+	size_t scratch_size() const;
+	// result = lhs * rhs * 2^(-64 size) mod m, scratch holds scratch_size() limbs
+	void montgomery_mul(limb_t* result, const limb_t* lhs, const limb_t* rhs, limb_t* scratch) const;
+};
@@ -0,0 +1,445 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "BigInt.h"
+#include "BigIntLimbs.h"
+
+/*
+ * Unsigned integers of a width fixed at compile time, for the values with a known
+ * bound (256 or 512 bit hashes and keys, 4096 bit moduli). The limbs are held in a
+ * std::array: no allocation, no leading zeros to drop and no sign. The arithmetic
+ * wraps around modulo 2^Bits like the built-in unsigned types, and the carry chains
+ * are unrolled over the limb count known at compile time, on the kernels of
+ * BigIntLimbs.h.
+ * Everything but the conversions from and to BigInt is constexpr, so constants fold
+ * at build time:
+ *
+ *	constexpr FixedBigInt<256> p("0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff");
+ *	constexpr FixedBigInt<256> half = (p + 1) >> 1;
+ *
+ * With MSVC the products and the divisions go through intrinsics, they are computed
+ * at run time.
+ */
+template <size_t Bits>
+class FixedBigInt
+{
+	static_assert(Bits > 0 && Bits % 64 == 0, "The width of a FixedBigInt is a whole number of 64 bit limbs");
+
+public:
+	typedef uint64_t limb_t;
+	static constexpr size_t LIMBS = Bits / 64;
+
+	constexpr FixedBigInt()
+		: m_limbs()
+	{
+	}
+	// Negative values wrap around: FixedBigInt<256>(-1) is 2^256 - 1
+	template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+	constexpr FixedBigInt(T value)
+		: m_limbs()
+	{
+		const bool negative = std::is_signed<T>::value && value < 0;
+		m_limbs[0] = static_cast<limb_t>(value);
+		for (size_t i = 1; i < LIMBS; ++i)
+			m_limbs[i] = negative ? ~limb_t(0) : 0;
+	}
+	// Least significant limb first
+	constexpr explicit FixedBigInt(const std::array<limb_t, LIMBS>& limbs)
+		: m_limbs(limbs)
+	{
+	}
+	// Zero extends or truncates a value of another width
+	template <size_t OtherBits>
+	constexpr explicit FixedBigInt(const FixedBigInt<OtherBits>& other)
+		: m_limbs()
+	{
+		for (size_t i = 0; i < LIMBS && i < FixedBigInt<OtherBits>::LIMBS; ++i)
+			m_limbs[i] = other.data()[i];
+	}
+	// Decimal digits, or hexadecimal ones after "0x". Throws std::invalid_argument for any
+	// other character and std::length_error when the value does not fit
+	constexpr explicit FixedBigInt(const char* digits);
+	// Throws std::domain_error for negative values and std::length_error when the value
+	// does not fit
+	explicit FixedBigInt(const BigInt& value);
+	BigInt to_bigint() const;
+
+	constexpr size_t size() const
+	{
+		return LIMBS;
+	}
+	constexpr limb_t* data()
+	{
+		return m_limbs.data();
+	}
+	constexpr const limb_t* data() const
+	{
+		return m_limbs.data();
+	}
+	constexpr bool is_zero() const
+	{
+		return bigint_detail::normalized_size(data(), LIMBS) == 0;
+	}
+
+#pragma region arithmetic
+	constexpr FixedBigInt operator-() const
+	{
+		FixedBigInt result;
+		bigint_detail::sub_n(result.data(), result.data(), data(), LIMBS);
+		return result;
+	}
+	constexpr const FixedBigInt& operator+=(const FixedBigInt& rhs)
+	{
+		add_limbs(data(), data(), rhs.data(), std::make_index_sequence<LIMBS>());
+		return *this;
+	}
+	constexpr const FixedBigInt& operator-=(const FixedBigInt& rhs)
+	{
+		sub_limbs(data(), data(), rhs.data(), std::make_index_sequence<LIMBS>());
+		return *this;
+	}
+	constexpr const FixedBigInt& operator*=(const FixedBigInt& rhs)
+	{
+		*this = *this * rhs;
+		return *this;
+	}
+	// Throws std::runtime_error when rhs is zero
+	constexpr const FixedBigInt& operator/=(const FixedBigInt& rhs)
+	{
+		*this = divmod(*this, rhs).first;
+		return *this;
+	}
+	constexpr const FixedBigInt& operator%=(const FixedBigInt& rhs)
+	{
+		*this = divmod(*this, rhs).second;
+		return *this;
+	}
+	friend constexpr FixedBigInt operator+(FixedBigInt lhs, const FixedBigInt& rhs)
+	{
+		return lhs += rhs;
+	}
+	friend constexpr FixedBigInt operator-(FixedBigInt lhs, const FixedBigInt& rhs)
+	{
+		return lhs -= rhs;
+	}
+	// Low Bits bits of the product: the rows stop at the width
+	friend constexpr FixedBigInt operator*(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		FixedBigInt result;
+		mul_rows(result.data(), lhs.data(), rhs.data(), std::make_index_sequence<LIMBS>());
+		return result;
+	}
+	friend constexpr FixedBigInt operator/(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return divmod(lhs, rhs).first;
+	}
+	friend constexpr FixedBigInt operator%(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return divmod(lhs, rhs).second;
+	}
+	// Full product, twice as wide as the operands
+	friend constexpr FixedBigInt<2 * Bits> full_product(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		FixedBigInt<2 * Bits> result;
+		for (size_t i = 0; i < LIMBS; ++i)
+			result.data()[i + LIMBS] = bigint_detail::addmul_1(result.data() + i, lhs.data(), LIMBS, rhs.m_limbs[i]);
+		return result;
+	}
+	// Quotient and remainder of a single division (Knuth's algorithm D), throws
+	// std::runtime_error when rhs is zero
+	friend constexpr std::pair<FixedBigInt, FixedBigInt> divmod(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return divide(lhs, rhs);
+	}
+#pragma endregion
+
+#pragma region bitwise
+	constexpr FixedBigInt operator~() const
+	{
+		FixedBigInt result;
+		for (size_t i = 0; i < LIMBS; ++i)
+			result.m_limbs[i] = ~m_limbs[i];
+		return result;
+	}
+	constexpr const FixedBigInt& operator&=(const FixedBigInt& rhs)
+	{
+		for (size_t i = 0; i < LIMBS; ++i)
+			m_limbs[i] &= rhs.m_limbs[i];
+		return *this;
+	}
+	constexpr const FixedBigInt& operator|=(const FixedBigInt& rhs)
+	{
+		for (size_t i = 0; i < LIMBS; ++i)
+			m_limbs[i] |= rhs.m_limbs[i];
+		return *this;
+	}
+	constexpr const FixedBigInt& operator^=(const FixedBigInt& rhs)
+	{
+		for (size_t i = 0; i < LIMBS; ++i)
+			m_limbs[i] ^= rhs.m_limbs[i];
+		return *this;
+	}
+	// Shifts by Bits or more give zero
+	constexpr const FixedBigInt& operator<<=(size_t count)
+	{
+		const size_t limbs = count / bigint_detail::LIMB_BITS;
+		const unsigned int bits = count % bigint_detail::LIMB_BITS;
+		for (size_t i = LIMBS; i-- > 0;)
+		{
+			limb_t limb = i >= limbs ? m_limbs[i - limbs] << bits : 0;
+			if (bits > 0 && i > limbs)
+				limb |= m_limbs[i - limbs - 1] >> (bigint_detail::LIMB_BITS - bits);
+			m_limbs[i] = limb;
+		}
+		return *this;
+	}
+	constexpr const FixedBigInt& operator>>=(size_t count)
+	{
+		const size_t limbs = count / bigint_detail::LIMB_BITS;
+		const unsigned int bits = count % bigint_detail::LIMB_BITS;
+		for (size_t i = 0; i < LIMBS; ++i)
+		{
+			limb_t limb = limbs < LIMBS - i ? m_limbs[i + limbs] >> bits : 0;
+			if (bits > 0 && limbs + 1 < LIMBS - i)
+				limb |= m_limbs[i + limbs + 1] << (bigint_detail::LIMB_BITS - bits);
+			m_limbs[i] = limb;
+		}
+		return *this;
+	}
+	friend constexpr FixedBigInt operator&(FixedBigInt lhs, const FixedBigInt& rhs)
+	{
+		return lhs &= rhs;
+	}
+	friend constexpr FixedBigInt operator|(FixedBigInt lhs, const FixedBigInt& rhs)
+	{
+		return lhs |= rhs;
+	}
+	friend constexpr FixedBigInt operator^(FixedBigInt lhs, const FixedBigInt& rhs)
+	{
+		return lhs ^= rhs;
+	}
+	friend constexpr FixedBigInt operator<<(FixedBigInt lhs, size_t count)
+	{
+		return lhs <<= count;
+	}
+	friend constexpr FixedBigInt operator>>(FixedBigInt lhs, size_t count)
+	{
+		return lhs >>= count;
+	}
+#pragma endregion
+
+#pragma region comparison
+	// Returns -1, 0 or 1
+	friend constexpr int compare(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		for (size_t i = LIMBS; i-- > 0;)
+		{
+			if (lhs.m_limbs[i] != rhs.m_limbs[i])
+				return lhs.m_limbs[i] < rhs.m_limbs[i] ? -1 : 1;
+		}
+		return 0;
+	}
+	friend constexpr bool operator==(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		for (size_t i = 0; i < LIMBS; ++i)
+		{
+			if (lhs.m_limbs[i] != rhs.m_limbs[i])
+				return false;
+		}
+		return true;
+	}
+	friend constexpr bool operator!=(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return !(lhs == rhs);
+	}
+	friend constexpr bool operator<(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return compare(lhs, rhs) < 0;
+	}
+	friend constexpr bool operator>(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return compare(lhs, rhs) > 0;
+	}
+	friend constexpr bool operator<=(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return compare(lhs, rhs) <= 0;
+	}
+	friend constexpr bool operator>=(const FixedBigInt& lhs, const FixedBigInt& rhs)
+	{
+		return compare(lhs, rhs) >= 0;
+	}
+#pragma endregion
+
+private:
+	std::array<limb_t, LIMBS> m_limbs;
+
+	// The carry chains over every limb, written out by the pack expansion
+	template <size_t... I>
+	static constexpr limb_t add_limbs(limb_t* r, const limb_t* a, const limb_t* b, std::index_sequence<I...>)
+	{
+		limb_t carry = 0;
+		((r[I] = bigint_detail::add_with_carry(a[I], b[I], carry)), ...);
+		return carry;
+	}
+	template <size_t... I>
+	static constexpr limb_t sub_limbs(limb_t* r, const limb_t* a, const limb_t* b, std::index_sequence<I...>)
+	{
+		limb_t borrow = 0;
+		((r[I] = bigint_detail::sub_with_borrow(a[I], b[I], borrow)), ...);
+		return borrow;
+	}
+	// r[0..LIMBS) = a * b mod 2^Bits, row I adds a[0..LIMBS - I) * b[I] at limb I
+	template <size_t... I>
+	static constexpr void mul_rows(limb_t* r, const limb_t* a, const limb_t* b, std::index_sequence<I...>)
+	{
+		(bigint_detail::addmul_1(r + I, a, LIMBS - I, b[I]), ...);
+	}
+
+	static constexpr std::pair<FixedBigInt, FixedBigInt> divide(const FixedBigInt& lhs, const FixedBigInt& rhs);
+};
+
+template <size_t Bits>
+constexpr FixedBigInt<Bits>::FixedBigInt(const char* digits)
+	: m_limbs()
+{
+	limb_t base = 10;
+	if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X'))
+	{
+		base = 16;
+		digits += 2;
+	}
+	if (*digits == '\0')
+	{
+		throw std::invalid_argument("Invalid input format string for FixedBigInt. No digits given.");
+	}
+	for (; *digits != '\0'; ++digits)
+	{
+		const char c = *digits;
+		limb_t digit = base;
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			digit = c - 'A' + 10;
+		if (digit >= base)
+		{
+			throw std::invalid_argument("Invalid input format string for FixedBigInt. Only decimal or 0x hexadecimal digits are allowed.");
+		}
+		limb_t carry = bigint_detail::mul_1(data(), data(), LIMBS, base);
+		carry += bigint_detail::add_1(data(), data(), LIMBS, digit);
+		if (carry != 0)
+		{
+			throw std::length_error("The value does not fit the width of the FixedBigInt");
+		}
+	}
+}
+
+template <size_t Bits>
+constexpr std::pair<FixedBigInt<Bits>, FixedBigInt<Bits>> FixedBigInt<Bits>::divide(const FixedBigInt& lhs, const FixedBigInt& rhs)
+{
+	using bigint_detail::LIMB_BITS;
+	const size_t dn = bigint_detail::normalized_size(rhs.data(), LIMBS);
+	if (dn == 0)
+	{
+		throw std::runtime_error("Math error: Attempted to divide by Zero\n");
+	}
+	const size_t un = bigint_detail::normalized_size(lhs.data(), LIMBS);
+	FixedBigInt quotient;
+	FixedBigInt remainder;
+	if (un < dn)
+		return std::pair<FixedBigInt, FixedBigInt>(quotient, lhs);
+	if (dn == 1)
+	{
+		remainder.m_limbs[0] = bigint_detail::div_1(quotient.data(), lhs.data(), un, rhs.m_limbs[0]);
+		return std::pair<FixedBigInt, FixedBigInt>(quotient, remainder);
+	}
+
+	// Normalized divisor d, with its top bit set, and dividend u shifted alike
+	const unsigned int shift = bigint_detail::count_leading_zeros(rhs.m_limbs[dn - 1]);
+	const FixedBigInt d = rhs << shift;
+	limb_t u[LIMBS + 1] = {};
+	for (size_t i = 0; i < un; ++i)
+		u[i] = lhs.m_limbs[i] << shift;
+	for (size_t i = 1; shift > 0 && i <= un; ++i)
+		u[i] |= lhs.m_limbs[i - 1] >> (LIMB_BITS - shift);
+
+	const limb_t top = d.m_limbs[dn - 1];
+	const limb_t next = d.m_limbs[dn - 2];
+	for (size_t j = un - dn + 1; j-- > 0;)
+	{
+		// Estimate of the quotient limb from the leading limbs, too large by 2 at most and
+		// then by 1 at most once checked against the second limb of d
+		limb_t q = ~limb_t(0);
+		limb_t r = 0;
+		bool r_overflow = false;
+		if (u[j + dn] < top)
+		{
+			q = bigint_detail::div_wide(u[j + dn], u[j + dn - 1], top, r);
+		}
+		else
+		{
+			r = u[j + dn - 1] + top;
+			r_overflow = r < top;
+		}
+		while (!r_overflow)
+		{
+			limb_t high = 0;
+			const limb_t low = bigint_detail::mul_wide(q, next, high);
+			if (high < r || (high == r && low <= u[j + dn - 2]))
+				break;
+			--q;
+			r += top;
+			r_overflow = r < top;
+		}
+
+		const limb_t borrow = bigint_detail::submul_1(u + j, d.data(), dn, q);
+		const limb_t leading = u[j + dn];
+		u[j + dn] = leading - borrow;
+		if (leading < borrow)
+		{
+			// Added back: the carry out cancels the borrow
+			--q;
+			u[j + dn] += bigint_detail::add_n(u + j, u + j, d.data(), dn);
+		}
+		quotient.m_limbs[j] = q;
+	}
+
+	for (size_t i = 0; i < dn; ++i)
+	{
+		remainder.m_limbs[i] = u[i] >> shift;
+		if (shift > 0)
+			remainder.m_limbs[i] |= u[i + 1] << (LIMB_BITS - shift);
+	}
+	return std::pair<FixedBigInt, FixedBigInt>(quotient, remainder);
+}
+
+template <size_t Bits>
+FixedBigInt<Bits>::FixedBigInt(const BigInt& value)
+	: m_limbs()
+{
+	if (value.is_negative())
+	{
+		throw std::domain_error("FixedBigInt values are unsigned");
+	}
+	if (value.num_digits() > LIMBS)
+	{
+		throw std::length_error("The value does not fit the width of the FixedBigInt");
+	}
+	std::copy(value.m_digits.begin(), value.m_digits.end(), m_limbs.begin());
+}
+
+template <size_t Bits>
+BigInt FixedBigInt<Bits>::to_bigint() const
+{
+	BigInt value;
+	value.m_digits.assign(m_limbs.data(), m_limbs.data() + LIMBS);
+	value.remove_leading_zeros();
+	return value;
+}
@@ -0,0 +1,366 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_BitScanReverse64)
+#pragma intrinsic(_BitScanForward64)
+#endif
+
+/*
+ * Limb primitives shared by the BigInt algorithms.
+ * A limb is a full 64 bit machine word, the double-width results are computed
+ * through unsigned __int128 when the compiler provides it, or through the
+ * MSVC intrinsics otherwise.
+ * The array kernels work on little endian limb ranges (least significant limb
+ * first) and never allocate: the caller provides the output storage.
+ * The inline kernels are constexpr, for the fixed width values of BigIntFixed.h,
+ * but for the products and divisions on the MSVC intrinsics.
+ */
+#if defined(__SIZEOF_INT128__) || !(defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+#define BIGINT_WIDE_CONSTEXPR constexpr
+#else
+#define BIGINT_WIDE_CONSTEXPR inline
+#endif
+
+namespace bigint_detail
+{
+	typedef uint64_t limb_t;
+	constexpr unsigned int LIMB_BITS = 64;
+
+	// Returns a + b + carry, carry is updated with the carry out (0 or 1)
+	constexpr limb_t add_with_carry(limb_t a, limb_t b, limb_t& carry)
+	{
+		const limb_t partial = a + carry;
+		const limb_t carry_partial = partial < carry;
+		const limb_t sum = partial + b;
+		carry = carry_partial + (sum < b);
+		return sum;
+	}
+
+	// Returns a - b - borrow, borrow is updated with the borrow out (0 or 1)
+	constexpr limb_t sub_with_borrow(limb_t a, limb_t b, limb_t& borrow)
+	{
+		const limb_t partial = a - b;
+		const limb_t borrow_partial = a < b;
+		const limb_t diff = partial - borrow;
+		borrow = borrow_partial + (partial < borrow);
+		return diff;
+	}
+
+	// Full 64x64 -> 128 bit product, returns the low word and stores the high word
+	BIGINT_WIDE_CONSTEXPR limb_t mul_wide(limb_t a, limb_t b, limb_t& high)
+	{
+#if defined(__SIZEOF_INT128__)
+		const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+		high = static_cast<limb_t>(product >> LIMB_BITS);
+		return static_cast<limb_t>(product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		return _umul128(a, b, &high);
+#else
+		// Portable fallback on 32 bit halves
+		const limb_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+		const limb_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+		const limb_t lo_lo = a_lo * b_lo;
+		const limb_t hi_lo = a_hi * b_lo;
+		const limb_t lo_hi = a_lo * b_hi;
+		const limb_t hi_hi = a_hi * b_hi;
+		const limb_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+		high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+		return (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+#endif
+	}
+
+	// Returns the low word of a * b + addend + carry, carry receives the high word.
+	// The result can never overflow 128 bits: (2^64-1)^2 + 2 * (2^64-1) < 2^128
+	BIGINT_WIDE_CONSTEXPR limb_t mul_add(limb_t a, limb_t b, limb_t addend, limb_t& carry)
+	{
+		limb_t high = 0;
+		limb_t low = mul_wide(a, b, high);
+		limb_t c = 0;
+		low = add_with_carry(low, addend, c);
+		high += c;
+		c = 0;
+		low = add_with_carry(low, carry, c);
+		carry = high + c;
+		return low;
+	}
+
+	// Divides the two limb value (high, low) by d, requires high < d.
+	// Returns the quotient and stores the remainder
+	BIGINT_WIDE_CONSTEXPR limb_t div_wide(limb_t high, limb_t low, limb_t d, limb_t& remainder)
+	{
+#if defined(__SIZEOF_INT128__)
+		const unsigned __int128 n = (static_cast<unsigned __int128>(high) << LIMB_BITS) | low;
+		remainder = static_cast<limb_t>(n % d);
+		return static_cast<limb_t>(n / d);
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1920
+		return _udiv128(high, low, d, &remainder);
+#else
+		// Restoring division one bit at a time
+		limb_t q = 0;
+		for (int i = LIMB_BITS - 1; i >= 0; --i)
+		{
+			const limb_t top = high >> (LIMB_BITS - 1);
+			high = (high << 1) | (low >> (LIMB_BITS - 1));
+			low <<= 1;
+			q <<= 1;
+			if (top || high >= d)
+			{
+				high -= d;
+				q |= 1;
+			}
+		}
+		remainder = high;
+		return q;
+#endif
+	}
+
+	// Number of zero bits above the most significant set bit, requires a != 0
+	BIGINT_WIDE_CONSTEXPR unsigned int count_leading_zeros(limb_t a)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<unsigned int>(__builtin_clzll(a));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanReverse64(&index, a);
+		return LIMB_BITS - 1 - index;
+#else
+		unsigned int count = 0;
+		for (limb_t mask = limb_t(1) << (LIMB_BITS - 1); (a & mask) == 0; mask >>= 1)
+			++count;
+		return count;
+#endif
+	}
+
+	// Number of zero bits below the least significant set bit, requires a != 0
+	BIGINT_WIDE_CONSTEXPR unsigned int count_trailing_zeros(limb_t a)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<unsigned int>(__builtin_ctzll(a));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, a);
+		return index;
+#else
+		unsigned int count = 0;
+		for (limb_t mask = 1; (a & mask) == 0; mask <<= 1)
+			++count;
+		return count;
+#endif
+	}
+
+#pragma region array-kernels
+	// r[0..n) = a[0..n) + b[0..n), returns the carry out
+	constexpr limb_t add_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+	{
+		limb_t carry = 0;
+		for (size_t i = 0; i < n; ++i)
+			r[i] = add_with_carry(a[i], b[i], carry);
+		return carry;
+	}
+
+	// r[0..n) = a[0..n) + b, returns the carry out
+	constexpr limb_t add_1(limb_t* r, const limb_t* a, size_t n, limb_t b)
+	{
+		size_t i = 0;
+		for (; i < n && b > 0; ++i)
+			r[i] = add_with_carry(a[i], 0, b);
+		for (; i < n && r != a; ++i)
+			r[i] = a[i];
+		return b;
+	}
+
+	// r[0..an) = a[0..an) + b[0..bn), requires an >= bn. Returns the carry out
+	constexpr limb_t add(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+	{
+		const limb_t carry = add_n(r, a, b, bn);
+		return add_1(r + bn, a + bn, an - bn, carry);
+	}
+
+	// r[0..n) = a[0..n) - b[0..n), returns the borrow out
+	constexpr limb_t sub_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n)
+	{
+		limb_t borrow = 0;
+		for (size_t i = 0; i < n; ++i)
+			r[i] = sub_with_borrow(a[i], b[i], borrow);
+		return borrow;
+	}
+
+	// r[0..n) = a[0..n) - b, returns the borrow out
+	constexpr limb_t sub_1(limb_t* r, const limb_t* a, size_t n, limb_t b)
+	{
+		size_t i = 0;
+		for (; i < n && b > 0; ++i)
+			r[i] = sub_with_borrow(a[i], 0, b);
+		for (; i < n && r != a; ++i)
+			r[i] = a[i];
+		return b;
+	}
+
+	// r[0..an) = a[0..an) - b[0..bn), requires an >= bn. Returns the borrow out
+	constexpr limb_t sub(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn)
+	{
+		const limb_t borrow = sub_n(r, a, b, bn);
+		return sub_1(r + bn, a + bn, an - bn, borrow);
+	}
+
+	// r[0..n) = a[0..n) * b, returns the high limb
+	BIGINT_WIDE_CONSTEXPR limb_t mul_1(limb_t* r, const limb_t* a, size_t n, limb_t b)
+	{
+		limb_t carry = 0;
+		for (size_t i = 0; i < n; ++i)
+			r[i] = mul_add(a[i], b, 0, carry);
+		return carry;
+	}
+
+	// r[0..n) += a[0..n) * b, returns the high limb
+	BIGINT_WIDE_CONSTEXPR limb_t addmul_1(limb_t* r, const limb_t* a, size_t n, limb_t b)
+	{
+		limb_t carry = 0;
+		for (size_t i = 0; i < n; ++i)
+			r[i] = mul_add(a[i], b, r[i], carry);
+		return carry;
+	}
+
+	// r[0..n) -= a[0..n) * b, returns the borrow limb
+	BIGINT_WIDE_CONSTEXPR limb_t submul_1(limb_t* r, const limb_t* a, size_t n, limb_t b)
+	{
+		limb_t carry = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const limb_t product = mul_add(a[i], b, 0, carry);
+			limb_t borrow = 0;
+			r[i] = sub_with_borrow(r[i], product, borrow);
+			carry += borrow;
+		}
+		return carry;
+	}
+
+	// q[0..n) = a[0..n) / d, returns the remainder
+	BIGINT_WIDE_CONSTEXPR limb_t div_1(limb_t* q, const limb_t* a, size_t n, limb_t d)
+	{
+		limb_t remainder = 0;
+		for (size_t i = n; i-- > 0;)
+			q[i] = div_wide(remainder, a[i], d, remainder);
+		return remainder;
+	}
+
+	// One past the index of the most significant limb where a[0..n) and b[0..n) differ,
+	// 0 when they are equal. Vectorized in BigIntBitwise.cpp
+	size_t top_difference(const limb_t* a, const limb_t* b, size_t n);
+
+	// Longest operands of cmp_n that are scanned inline rather than by top_difference
+	constexpr size_t CMP_INLINE_LIMBS = 4;
+
+	// Compares a[0..n) with b[0..n) starting from the most significant limb, returns -1, 0 or 1
+	inline int cmp_n(const limb_t* a, const limb_t* b, size_t n)
+	{
+		size_t i = n;
+		if (n > CMP_INLINE_LIMBS && a[n - 1] == b[n - 1])
+			i = top_difference(a, b, n);
+		else
+			while (i > 0 && a[i - 1] == b[i - 1])
+				--i;
+		if (i == 0)
+			return 0;
+		return a[i - 1] < b[i - 1] ? -1 : 1;
+	}
+
+	// Number of limbs of a[0..n) once the most significant zero limbs are dropped
+	constexpr size_t normalized_size(const limb_t* a, size_t n)
+	{
+		while (n > 0 && a[n - 1] == 0)
+			--n;
+		return n;
+	}
+#pragma endregion
+
+#pragma region constant-time
+	// All ones when condition is 1, zero when it is 0. The empty asm statement hides the
+	// value from the optimizer, which could turn the masked selections back into branches
+	inline limb_t mask_from(limb_t condition)
+	{
+		limb_t mask = 0 - condition;
+#if defined(__GNUC__) || defined(__clang__)
+		__asm__("" : "+r"(mask));
+#endif
+		return mask;
+	}
+
+	// r[0..n) = mask ? a[0..n) : b[0..n) for an all ones or zero mask, without branching.
+	// r may alias a or b
+	inline void select_n(limb_t* r, limb_t mask, const limb_t* a, const limb_t* b, size_t n)
+	{
+		for (size_t i = 0; i < n; ++i)
+			r[i] = b[i] ^ (mask & (a[i] ^ b[i]));
+	}
+#pragma endregion
+
+#pragma region bitwise-kernels
+	// Vectorized in BigIntBitwise.cpp, the widest instruction set available is picked at
+	// the first call. r may alias the operands
+	enum class SimdLevel
+	{
+		scalar,
+		avx2,
+		avx512
+	};
+	// Instruction set in use
+	SimdLevel simd_level();
+	// Restricts the kernels to level, capped to what the CPU supports, and returns the
+	// previous level. Meant for tests and benchmarks, not thread safe against running kernels
+	SimdLevel set_simd_level(SimdLevel level);
+
+	// r[0..n) = a[0..n) & b[0..n)
+	void and_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n);
+	// r[0..n) = a[0..n) | b[0..n)
+	void or_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n);
+	// r[0..n) = a[0..n) ^ b[0..n)
+	void xor_n(limb_t* r, const limb_t* a, const limb_t* b, size_t n);
+	// r[0..n) = a[0..n) << count, requires 0 < count < LIMB_BITS. Returns the bits shifted out.
+	// r may alias a or sit above it
+	limb_t lshift(limb_t* r, const limb_t* a, size_t n, unsigned int count);
+	// r[0..n) = a[0..n) >> count, requires 0 < count < LIMB_BITS. Returns the bits shifted out
+	// (left aligned in the returned limb). r may alias a or sit below it
+	limb_t rshift(limb_t* r, const limb_t* a, size_t n, unsigned int count);
+#pragma endregion
+
+#pragma region multiplication
+	// r[0..an+bn) = a[0..an) * b[0..bn), O(an * bn). r must not overlap the operands
+	void mul_basecase(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn);
+	// r[0..2n) = a[0..n)^2, computing every cross product once. r must not overlap the operand
+	void sqr_basecase(limb_t* r, const limb_t* a, size_t n);
+	// r[0..an+bn) = a[0..an) * b[0..bn), requires an >= bn >= 1. r must not overlap the operands.
+	// Picks schoolbook, Karatsuba, Toom-3 or NTT based on the operand sizes and BigInt::thresholds()
+	void mul(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn);
+	// r[0..2n) = a[0..n)^2, requires n >= 1. r must not overlap the operand
+	void sqr(limb_t* r, const limb_t* a, size_t n);
+	// Three primes number theoretic transform products, any operand sizes
+	void mul_ntt(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn);
+	void sqr_ntt(limb_t* r, const limb_t* a, size_t n);
+	// r[0..an+bn) = a[0..an) * b[0..bn), requires an >= bn >= 1, from the products of blocks
+	// of at most block limbs. The products landing at the same block are summed in memory
+	// and the blocks of r written once, in order, so the working memory stays O(block):
+	// the out of core multiplication of operands in mapped files (see BigIntMapped.h)
+	void mul_blocked(limb_t* r, const limb_t* a, size_t an, const limb_t* b, size_t bn, size_t block);
+#pragma endregion
+
+#pragma region division
+	// Divides u[0..un) by d[0..dn), requires un >= dn >= 1, the most significant bit of
+	// d[dn - 1] set (normalized divisor) and u[un - dn..un) < d.
+	// Stores the un - dn quotient limbs in q and leaves the remainder in u[0..dn).
+	// Picks Knuth's algorithm D or the recursive division based on BigInt::thresholds()
+	void div_qr(limb_t* q, limb_t* u, size_t un, const limb_t* d, size_t dn);
+#pragma endregion
+
+#pragma region modular
+	// -m0^-1 mod 2^64 for an odd m0
+	limb_t montgomery_inverse(limb_t m0);
+	// Montgomery reduction: r[0..n) = t[0..2n) * B^-n mod m, requires t < m * B^n and
+	// inverse = montgomery_inverse(m[0]). t is clobbered, r may alias it.
+	// Runs in constant time: the same operations for any value of t
+	void redc(limb_t* r, limb_t* t, const limb_t* m, size_t n, limb_t inverse);
+#pragma endregion
+}
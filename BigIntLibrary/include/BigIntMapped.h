@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+/*
+ * Digits in memory mapped files, for values larger than the memory at hand (digits of
+ * constants, huge factorials). Every allocation of at least min_bytes gets a mapping of
+ * its own temporary file in directory, deleted as soon as it is created (or on close,
+ * on Windows), so nothing is left behind; the smaller ones come from upstream.
+ * The operating system pages the digits in and out: the mappings are advised for
+ * sequential access, the order in which the additions, subtractions, shifts and
+ * comparisons walk the limbs. While such a resource is installed, multiplications of
+ * operands over mul_block_limbs() switch to an out of core blocked product whose
+ * working memory stays of the order of the block, see bigint_detail::mul_blocked.
+ *
+ *	BigIntMappedResource mapped("/scratch");
+ *	{
+ *		BigIntResourceScope scope(mapped);
+ *		const BigInt huge = pow(BigInt(7), 2000000000);
+ *	}
+ *
+ * Values taken from the resource must be destroyed before it.
+ */
+class BigIntMappedResource : public std::pmr::memory_resource
+{
+public:
+	// An empty directory stands for the temporary directory of the system
+	explicit BigIntMappedResource(const std::string& directory = std::string(), size_t min_bytes = 1 << 20,
+		std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+	BigIntMappedResource(const BigIntMappedResource&) = delete;
+	BigIntMappedResource& operator=(const BigIntMappedResource&) = delete;
+
+	const std::string& directory() const
+	{
+		return m_directory;
+	}
+	size_t min_bytes() const
+	{
+		return m_min_bytes;
+	}
+	// Bytes of the mappings alive
+	size_t mapped_bytes() const
+	{
+		return m_mapped_bytes.load(std::memory_order_relaxed);
+	}
+
+	// Limbs of the blocks of the out of core multiplication, 4M limbs (32 MB) by default
+	size_t mul_block_limbs() const
+	{
+		return m_mul_block_limbs;
+	}
+	// Throws std::invalid_argument when limbs is 0
+	void set_mul_block_limbs(size_t limbs);
+
+	// Block of the out of core multiplication when a mapped resource is installed on the
+	// calling thread, SIZE_MAX otherwise
+	static size_t current_mul_block_limbs();
+
+private:
+	std::string m_directory;
+	size_t m_min_bytes;
+	std::pmr::memory_resource* m_upstream;
+	size_t m_mul_block_limbs;
+	std::atomic<size_t> m_mapped_bytes;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include "BigInt.h"
+
+/*
+ * Arithmetic modulo a fixed positive integer.
+ * A Modulus precomputes, once, the constants of Montgomery multiplication (odd
+ * moduli) and of Barrett reduction (any modulus): the products and powers that
+ * follow reduce without any division. Keep a Modulus around to run many
+ * exponentiations against the same modulus.
+ * Every result is the canonical residue in [0, m), also for negative operands.
+ */
+class Modulus
+{
+public:
+	// Throws std::domain_error unless modulus > 0
+	explicit Modulus(const BigInt& modulus);
+
+	const BigInt& value() const
+	{
+		return m_modulus;
+	}
+	// x mod m, a single division for the values that do not fit the Barrett reduction
+	BigInt reduce(const BigInt& x) const;
+	// lhs * rhs mod m
+	BigInt mul(const BigInt& lhs, const BigInt& rhs) const;
+	// base^exponent mod m, throws std::domain_error for negative exponents
+	BigInt pow(const BigInt& base, const BigInt& exponent) const;
+
+private:
+	typedef uint64_t digit_t;
+
+	BigInt m_modulus;
+	// Number of digits of the modulus
+	size_t m_size;
+	// floor(B^(2 m_size) / m) with B = 2^BIGINT_DIGIT_BITS
+	BigInt m_barrett_mu;
+	// Montgomery constants, only for odd moduli: -m^-1 mod B and B^(2 m_size) mod m
+	bool m_montgomery;
+	digit_t m_inverse;
+	BigInt m_r2;
+
+	// x mod m for 0 <= x < B^(2 m_size)
+	BigInt barrett_reduce(const BigInt& x) const;
+	BigInt montgomery_pow(const BigInt& base, const BigInt& exponent) const;
+	BigInt barrett_pow(const BigInt& base, const BigInt& exponent) const;
+};
+
+// base^exponent mod modulus in [0, modulus), without building the full power.
+// Use a Modulus to reuse the precomputation across calls
+BigInt powmod(const BigInt& base, const BigInt& exponent, const BigInt& modulus);
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BigIntLimbs.h"
+
+/*
+ * Left-to-right sliding window exponentiation, shared by pow and by the Montgomery
+ * and Barrett paths of Modulus. The exponent is scanned from its most significant
+ * bit: every zero bit costs a squaring, every window of up to window_bits(bits) bits
+ * ending with a one costs its squarings plus a single multiplication by a
+ * precomputed odd power.
+ */
+namespace bigint_detail
+{
+	// Window size for an exponent of the given bits
+	inline int window_bits(size_t bits)
+	{
+		return bits < 8 ? 1 : bits < 24 ? 2 : bits < 80 ? 3 : bits < 240 ? 4 : bits < 672 ? 5 : 6;
+	}
+
+	// base^exponent over any representation: square(x) and multiply(x, y) update x in
+	// place, one is the neutral element. The exponent is the little endian limbs
+	// exponent[0..exponent_n), its top limb may be zero only when exponent_n is 1
+	template <typename Element, typename Square, typename Multiply>
+	Element window_power(const Element& one, const Element& base, const limb_t* exponent, size_t exponent_n, Square square, Multiply multiply)
+	{
+		const auto bit = [exponent](size_t i)
+		{
+			return (exponent[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1;
+		};
+		if (exponent[exponent_n - 1] == 0)
+			return one;
+		const size_t bits = exponent_n * LIMB_BITS - count_leading_zeros(exponent[exponent_n - 1]);
+		const int window = window_bits(bits);
+		// base^1, base^3, ..., base^(2^window - 1)
+		const size_t odd_count = size_t(1) << (window - 1);
+		std::vector<Element> odd_powers;
+		odd_powers.reserve(odd_count);
+		odd_powers.push_back(base);
+		if (window > 1)
+		{
+			Element base_square = base;
+			square(base_square);
+			while (odd_powers.size() < odd_count)
+			{
+				odd_powers.push_back(odd_powers.back());
+				multiply(odd_powers.back(), base_square);
+			}
+		}
+		// The first window sets the result, instead of squaring one
+		Element result = one;
+		bool started = false;
+		for (size_t i = bits; i-- > 0;)
+		{
+			if (bit(i) == 0)
+			{
+				square(result);
+				continue;
+			}
+			// Longest window ending at bit i that starts with a set bit
+			size_t j = i + 1 >= static_cast<size_t>(window) ? i + 1 - window : 0;
+			while (bit(j) == 0)
+				++j;
+			size_t value = 0;
+			for (size_t k = i + 1; k-- > j;)
+			{
+				value = 2 * value + bit(k);
+				if (started)
+					square(result);
+			}
+			if (started)
+				multiply(result, odd_powers[value >> 1]);
+			else
+				result = odd_powers[value >> 1];
+			started = true;
+			i = j;
+		}
+		return result;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "BigInt.h"
+
+/*
+ * Product tree of a set of moduli, for the reduction of one value modulo all of
+ * them. Level 0 holds the moduli, every node above is the product of two nodes
+ * below and the root is the product of all of them. The remainder tree walks
+ * down from x mod root, reducing the remainder of a node by its children, so the
+ * divisions shrink with the nodes and the whole batch costs a few products of
+ * the size of the root instead of one division of x per modulus.
+ *
+ *	const ProductTree tree(moduli);
+ *	const std::vector<BigInt> residues = tree.remainders(x);
+ *
+ * The levels are built and walked in parallel chunks when a thread pool is
+ * installed (see BigIntThreadPool.h).
+ */
+class ProductTree
+{
+public:
+	// Throws std::domain_error unless every modulus is positive
+	explicit ProductTree(std::vector<BigInt> moduli);
+
+	size_t size() const
+	{
+		return m_levels.front().size();
+	}
+	const std::vector<BigInt>& moduli() const
+	{
+		return m_levels.front();
+	}
+	// Product of all the moduli, 1 for an empty tree
+	const BigInt& product() const;
+	// x mod m for every modulus m, in [0, m) and in the order of the moduli
+	std::vector<BigInt> remainders(const BigInt& x) const;
+
+private:
+	// m_levels[0] holds the moduli, m_levels.back() the root (when there is a modulus)
+	std::vector<std::vector<BigInt>> m_levels;
+
+	// Remainder tree of x, modulo the squares of the nodes when squares is set
+	std::vector<BigInt> descend(const BigInt& x, bool squares) const;
+	friend std::vector<BigInt> batch_gcd(const std::vector<BigInt>& moduli);
+};
+
+// gcd(m, product of the other moduli) for every modulus m, with Bernstein's batch GCD:
+// the remainder tree of the product modulo the squared nodes gives every (P mod m^2) / m
+// at once. A result greater than 1 reveals a factor shared with another modulus (RSA
+// keys generated with a weak random source share primes). Throws std::domain_error
+// unless every modulus is positive
+std::vector<BigInt> batch_gcd(const std::vector<BigInt>& moduli);
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+
+#include "BigInt.h"
+
+/*
+ * Compact binary encoding of BigInt values, for files and messages holding many of
+ * them. Every value is a varint header followed by its magnitude:
+ * - the header is 2 * bytes + (1 when negative), 7 bits per byte least significant
+ *   first, the high bit set on every byte but the last (LEB128);
+ * - the magnitude is bytes little endian bytes, without leading zeros.
+ * Zero takes one byte, a value below 2^504 one header byte more than its magnitude.
+ *
+ *	BigIntWriter writer(file);
+ *	writer.write(values);
+ *	writer.flush();
+ *
+ *	BigIntReader reader(mapped_bytes, mapped_size);
+ *	BigInt value;
+ *	while (reader.next(value))
+ *		...
+ */
+class BigIntWriter
+{
+public:
+	// Values are encoded in a buffer of buffer_bytes, written to out when it is full
+	explicit BigIntWriter(std::ostream& out, size_t buffer_bytes = 1 << 16);
+	// Flushes what is left, the errors are lost: call flush() to see them
+	~BigIntWriter();
+	BigIntWriter(const BigIntWriter&) = delete;
+	BigIntWriter& operator=(const BigIntWriter&) = delete;
+
+	void write(const BigInt& value);
+	void write(const BigInt* values, size_t count);
+	void write(const std::vector<BigInt>& values);
+	// Writes the buffer to the stream, throws std::runtime_error when the stream fails
+	void flush();
+
+	// Bytes of the encoding of value
+	static size_t encoded_size(const BigInt& value);
+	// Writes the encoding of value to out, which holds encoded_size(value) bytes.
+	// Returns the bytes written
+	static size_t encode(const BigInt& value, std::byte* out);
+
+private:
+	std::ostream& m_out;
+	std::vector<std::byte> m_buffer;
+	size_t m_used;
+};
+
+/*
+ * Decodes the values one at a time, from memory (a mapped file, a message) or from
+ * a stream read through a buffer. Nothing is decoded before it is asked for, and
+ * skip() passes over a value reading its header only.
+ * Malformed or truncated data throws std::invalid_argument.
+ */
+class BigIntReader
+{
+public:
+	// Reads data[0..size) in place, the memory must outlive the reader
+	BigIntReader(const std::byte* data, size_t size);
+	// Reads in from its current position, buffer_bytes at a time
+	explicit BigIntReader(std::istream& in, size_t buffer_bytes = 1 << 16);
+	BigIntReader(const BigIntReader&) = delete;
+	BigIntReader& operator=(const BigIntReader&) = delete;
+
+	// Decodes the next value, returns false at the end of the data
+	bool next(BigInt& value);
+	// Passes over the next value, returns false at the end of the data
+	bool skip();
+	// Decodes up to count values, returns the number decoded
+	size_t read(BigInt* values, size_t count);
+	// Decodes every value left
+	std::vector<BigInt> read_all();
+
+	// Decodes the value at data[0..size) and returns the bytes read
+	static size_t decode(const std::byte* data, size_t size, BigInt& value);
+
+private:
+	// Stream source, nullptr when reading memory
+	std::istream* m_in;
+	std::vector<std::byte> m_buffer;
+	// The bytes available: the memory read, or what the buffer holds
+	const std::byte* m_data;
+	size_t m_size;
+	size_t m_position;
+
+	// Makes at least n bytes available from m_position, returns false when the data ends before
+	bool ensure(size_t n);
+	// Reads the header of the next value, returns the bytes of the whole encoding or 0 at the end
+	size_t next_size();
+};
@@ -0,0 +1,311 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+
+#include "BigIntLimbs.h"
+
+/*
+ * Digit storage of a BigInt with a small buffer optimization.
+ * Up to INLINE_LIMBS limbs (256 bits) live inside the object, longer values move
+ * to a heap block that grows geometrically. The interface follows the subset of
+ * std::vector used by the arithmetic, so the algorithms keep working on data().
+ * The header word packs the length with two flags: the heap flag and a spare
+ * bit that the owner can use (BigInt keeps its sign there), so a BigInt takes
+ * 40 bytes and the common small values never allocate.
+ * Heap blocks come from the memory resource installed on the allocating thread
+ * (see BigInt::set_memory_resource) and remember it, so a block is always grown
+ * and released through the resource it was taken from.
+ */
+namespace bigint_detail
+{
+	// Resource used for new heap blocks on the calling thread, never null
+	std::pmr::memory_resource* current_limb_resource();
+
+	class LimbVector
+	{
+	public:
+		typedef limb_t value_type;
+		typedef limb_t* iterator;
+		typedef const limb_t* const_iterator;
+		typedef std::reverse_iterator<iterator> reverse_iterator;
+		typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+		static constexpr size_t INLINE_LIMBS = 4;
+
+#pragma region constructors
+		LimbVector() noexcept : m_header(0)
+		{
+		}
+		LimbVector(size_t n, limb_t value) : m_header(0)
+		{
+			resize(n, value);
+		}
+		LimbVector(const_iterator first, const_iterator last) : m_header(0)
+		{
+			assign(first, last);
+		}
+		LimbVector(const LimbVector& other) : m_header(0)
+		{
+			assign(other.begin(), other.end());
+			set_flag(other.flag());
+		}
+		LimbVector(LimbVector&& other) noexcept : m_header(0)
+		{
+			steal(other);
+		}
+		LimbVector& operator=(const LimbVector& other)
+		{
+			if (this != &other)
+			{
+				assign(other.begin(), other.end());
+				set_flag(other.flag());
+			}
+			return *this;
+		}
+		LimbVector& operator=(LimbVector&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				m_header = 0;
+				steal(other);
+			}
+			return *this;
+		}
+		~LimbVector()
+		{
+			release();
+		}
+#pragma endregion
+
+#pragma region element-access
+		size_t size() const
+		{
+			return m_header >> SIZE_SHIFT;
+		}
+		bool empty() const
+		{
+			return size() == 0;
+		}
+		size_t capacity() const
+		{
+			return on_heap() ? m_heap.capacity : INLINE_LIMBS;
+		}
+		limb_t* data()
+		{
+			return on_heap() ? m_heap.data : m_inline;
+		}
+		const limb_t* data() const
+		{
+			return on_heap() ? m_heap.data : m_inline;
+		}
+		limb_t& operator[](size_t k)
+		{
+			return data()[k];
+		}
+		const limb_t& operator[](size_t k) const
+		{
+			return data()[k];
+		}
+		limb_t& back()
+		{
+			return data()[size() - 1];
+		}
+		const limb_t& back() const
+		{
+			return data()[size() - 1];
+		}
+		iterator begin()
+		{
+			return data();
+		}
+		iterator end()
+		{
+			return data() + size();
+		}
+		const_iterator begin() const
+		{
+			return data();
+		}
+		const_iterator end() const
+		{
+			return data() + size();
+		}
+		reverse_iterator rbegin()
+		{
+			return reverse_iterator(end());
+		}
+		reverse_iterator rend()
+		{
+			return reverse_iterator(begin());
+		}
+		const_reverse_iterator rbegin() const
+		{
+			return const_reverse_iterator(end());
+		}
+		const_reverse_iterator rend() const
+		{
+			return const_reverse_iterator(begin());
+		}
+		// True when the limbs live in a heap block rather than inside the object
+		bool on_heap() const
+		{
+			return (m_header & HEAP_FLAG) != 0;
+		}
+		// Spare header bit owned by the user of the container, kept by copies and moves
+		bool flag() const
+		{
+			return (m_header & USER_FLAG) != 0;
+		}
+		void set_flag(bool value)
+		{
+			m_header = value ? m_header | USER_FLAG : m_header & ~USER_FLAG;
+		}
+#pragma endregion
+
+#pragma region modifiers
+		void reserve(size_t n)
+		{
+			if (n > capacity())
+				reallocate(n);
+		}
+		// New limbs are set to zero, like std::vector
+		void resize(size_t n)
+		{
+			resize(n, 0);
+		}
+		void resize(size_t n, limb_t value)
+		{
+			const size_t old_size = size();
+			if (n > capacity())
+				reallocate(std::max(n, 2 * capacity()));
+			if (n > old_size)
+				std::fill(data() + old_size, data() + n, value);
+			set_size(n);
+		}
+		void clear()
+		{
+			set_size(0);
+		}
+		void push_back(limb_t value)
+		{
+			const size_t n = size();
+			if (n == capacity())
+				reallocate(2 * capacity());
+			data()[n] = value;
+			set_size(n + 1);
+		}
+		void pop_back()
+		{
+			set_size(size() - 1);
+		}
+		void assign(const_iterator first, const_iterator last)
+		{
+			const size_t n = last - first;
+			if (n > capacity())
+			{
+				// Drop the old limbs instead of copying them into the new block
+				set_size(0);
+				reallocate(n);
+			}
+			std::copy(first, last, data());
+			set_size(n);
+		}
+		// Inserts n copies of value before position
+		iterator insert(const_iterator position, size_t n, limb_t value)
+		{
+			const size_t offset = position - begin();
+			const size_t old_size = size();
+			resize(old_size + n);
+			limb_t* const first = data() + offset;
+			std::copy_backward(first, data() + old_size, data() + old_size + n);
+			std::fill(first, first + n, value);
+			return first;
+		}
+		iterator erase(const_iterator first, const_iterator last)
+		{
+			limb_t* const target = data() + (first - begin());
+			const size_t n = last - first;
+			std::copy(target + n, end(), target);
+			set_size(size() - n);
+			return target;
+		}
+		void swap(LimbVector& other) noexcept
+		{
+			LimbVector temp(std::move(other));
+			other = std::move(*this);
+			*this = std::move(temp);
+		}
+#pragma endregion
+
+		// Compares the limbs only, the user flag is not part of the value
+		friend bool operator==(const LimbVector& lhs, const LimbVector& rhs)
+		{
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+		}
+		friend bool operator!=(const LimbVector& lhs, const LimbVector& rhs)
+		{
+			return !(lhs == rhs);
+		}
+
+	private:
+		static constexpr size_t USER_FLAG = 1;
+		static constexpr size_t HEAP_FLAG = 2;
+		static constexpr unsigned int SIZE_SHIFT = 2;
+
+		// Length << SIZE_SHIFT | HEAP_FLAG | USER_FLAG
+		size_t m_header;
+		union
+		{
+			limb_t m_inline[INLINE_LIMBS] = {};
+			struct
+			{
+				limb_t* data;
+				size_t capacity;
+				std::pmr::memory_resource* resource;
+			} m_heap;
+		};
+
+		void set_size(size_t n)
+		{
+			m_header = (n << SIZE_SHIFT) | (m_header & (HEAP_FLAG | USER_FLAG));
+		}
+
+		// Moves the limbs to a heap block of new_capacity limbs (at least the size)
+		void reallocate(size_t new_capacity)
+		{
+			std::pmr::memory_resource* const resource = on_heap() ? m_heap.resource : current_limb_resource();
+			limb_t* const block = static_cast<limb_t*>(resource->allocate(new_capacity * sizeof(limb_t), alignof(limb_t)));
+			std::copy(begin(), end(), block);
+			release();
+			m_heap.data = block;
+			m_heap.capacity = new_capacity;
+			m_heap.resource = resource;
+			m_header |= HEAP_FLAG;
+		}
+
+		void release()
+		{
+			if (on_heap())
+				m_heap.resource->deallocate(m_heap.data, m_heap.capacity * sizeof(limb_t), alignof(limb_t));
+		}
+
+		// Takes the contents of other, which is left empty. Requires *this to own no block
+		void steal(LimbVector& other)
+		{
+			if (other.on_heap())
+			{
+				m_heap = other.m_heap;
+			}
+			else
+			{
+				std::copy(other.m_inline, other.m_inline + other.size(), m_inline);
+			}
+			m_header = other.m_header;
+			other.m_header = 0;
+		}
+	};
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Work stealing pool for the multiplication of very large values.
+ * Nothing runs in parallel until a pool is installed with BigInt::set_thread_pool:
+ * from then on the Karatsuba and Toom-Cook subproducts and the NTT transforms of
+ * the operands of at least BigIntThresholds::parallel_mul digits are spread over
+ * the workers, smaller subproblems stay serial. Divisions benefit through the
+ * multiplications of the recursive algorithm.
+ *
+ *	BigIntThreadPool pool(32);
+ *	BigIntThreadPool* const previous = BigInt::set_thread_pool(&pool);
+ *	const BigInt product = a * b;
+ *	BigInt::set_thread_pool(previous);
+ *
+ * Every worker owns a deque: the tasks it spawns are pushed and popped at the back,
+ * idle workers steal from the front of the others. A thread waiting for its tasks
+ * runs the ones still queued meanwhile, so nested parallel sections never deadlock,
+ * then sleeps until the stolen ones finish.
+ * Tasks take the digits of their values from the memory resource of the thread that
+ * started them (BigInt::set_memory_resource), wherever they run: a resource installed
+ * around parallel computations must be thread safe, like BigIntArena.
+ * The pool must outlive the computations that use it.
+ */
+namespace bigint_detail
+{
+	class TaskGroup;
+}
+
+class BigIntThreadPool
+{
+public:
+	// 0 threads picks std::thread::hardware_concurrency()
+	explicit BigIntThreadPool(size_t threads = 0);
+	BigIntThreadPool(const BigIntThreadPool&) = delete;
+	BigIntThreadPool& operator=(const BigIntThreadPool&) = delete;
+	~BigIntThreadPool();
+
+	size_t size() const
+	{
+		return m_workers.size();
+	}
+
+private:
+	friend class bigint_detail::TaskGroup;
+	struct Task
+	{
+		std::function<void()> function;
+		bigint_detail::TaskGroup* group;
+		// Resource of the thread that started the task, installed while it runs
+		std::pmr::memory_resource* resource;
+	};
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	// One queue per worker, plus a last one shared by the threads outside the pool
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_workers;
+	// Tasks waiting in the queues, the idle workers sleep while it is zero
+	std::atomic<size_t> m_queued;
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_wake;
+	bool m_stop;
+
+	void push(Task task);
+	// Pops a task of the calling thread's queue, or steals one. Returns false if every queue is empty
+	bool try_pop(Task& task);
+	// Pops the latest task of group from the calling thread's queue, where run() put them.
+	// Returns false if none is left there
+	bool try_pop(Task& task, const bigint_detail::TaskGroup* group);
+	static void run(Task& task);
+	void work(size_t index);
+};
+
+namespace bigint_detail
+{
+	// The installed pool if operands of n digits are worth splitting, nullptr otherwise
+	BigIntThreadPool* parallel_pool(size_t n);
+
+	// Fork-join section: run() hands a task to the pool, or runs it at once without a
+	// pool, and wait() returns when all of them finished, rethrowing the first exception.
+	// The destructor waits too, the tasks may reference the caller's stack
+	class TaskGroup
+	{
+	public:
+		explicit TaskGroup(BigIntThreadPool* pool);
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+		~TaskGroup();
+
+		bool parallel() const
+		{
+			return m_pool != nullptr;
+		}
+		void run(std::function<void()> function);
+		void wait();
+
+	private:
+		friend class ::BigIntThreadPool;
+		BigIntThreadPool* m_pool;
+		std::atomic<size_t> m_pending;
+		std::exception_ptr m_error;
+		// Guards m_error and the last decrement of m_pending, m_done signals it
+		std::mutex m_mutex;
+		std::condition_variable m_done;
+
+		// Called once per task, error is null unless the task threw
+		void finish(std::exception_ptr error);
+		// Runs the queued tasks of this group, then waits for the ones other threads took
+		void join();
+	};
+}
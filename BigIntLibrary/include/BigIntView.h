@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "BigInt.h"
+#include "BigIntLimbs.h"
+
+/*
+ * Read only view of a value stored elsewhere: the limbs of a BigInt, or 64 bit limbs
+ * in any memory (a file mapping, a message buffer, shared memory). Nothing is copied,
+ * so the memory must outlive the view and a viewed BigInt must not be modified.
+ *
+ *	const BigIntView received(message_limbs, count);
+ *	if (received == BigIntView(key))
+ *		...
+ *	const BigIntView limbs(key);
+ *	write(fd, limbs.data(), limbs.size() * sizeof(uint64_t));
+ */
+class BigIntView
+{
+public:
+	typedef uint64_t limb_t;
+
+	BigIntView(const BigInt& value)
+		: BigIntView(value.m_digits.data(), value.num_digits(), value.is_negative())
+	{
+	}
+	// limbs[0..size) least significant first, the leading zero limbs are skipped
+	BigIntView(const limb_t* limbs, size_t size, bool negative = false)
+		: m_limbs(limbs), m_size(bigint_detail::normalized_size(limbs, size)), m_negative(negative && m_size > 0)
+	{
+	}
+
+	// The significant limbs, none for zero
+	const limb_t* data() const
+	{
+		return m_limbs;
+	}
+	size_t size() const
+	{
+		return m_size;
+	}
+	bool is_zero() const
+	{
+		return m_size == 0;
+	}
+	bool is_negative() const
+	{
+		return m_negative;
+	}
+	BigInt to_bigint() const;
+
+	// Same as BigInt::byte_size and BigInt::to_bytes
+	size_t byte_size(size_t word_size = 1) const;
+	size_t to_bytes(std::byte* out, size_t capacity, Endian word_order = Endian::big, size_t word_size = 1, Endian byte_order = Endian::big) const;
+
+	// Returns -1, 0 or 1
+	friend int compare(const BigIntView& lhs, const BigIntView& rhs);
+	friend bool operator==(const BigIntView& lhs, const BigIntView& rhs)
+	{
+		return compare(lhs, rhs) == 0;
+	}
+	friend bool operator!=(const BigIntView& lhs, const BigIntView& rhs)
+	{
+		return compare(lhs, rhs) != 0;
+	}
+
+private:
+	const limb_t* m_limbs;
+	size_t m_size;
+	bool m_negative;
+};
@@ -1,7 +1,25 @@
 #include "pch.h"
 
 #include "BigInt.h"
+#include "BigIntArena.h"
+#include "BigIntBatch.h"
+#include "BigIntConstantTime.h"
+#include "BigIntFixed.h"
+#include "BigIntLimbs.h"
+#include "BigIntMapped.h"
+#include "BigIntModulus.h"
+#include "BigIntProductTree.h"
+#include "BigIntSerialization.h"
+#include "BigIntThreadPool.h"
+#include "BigIntView.h"
+#include <climits>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
 
 TEST(Constructors, EmptyConstructors) {
 	EXPECT_NO_THROW(BigInt bi);
@@ -26,6 +44,104 @@ TEST(Constructors, BigIntStringConstructors) {
 	EXPECT_NO_THROW(BigInt bi("-0"));
 }
 
+TEST(Constructors, CopyAndMove) {
+	// 2^64 - 1, 2^256 - 1 (four digits, stored inline) and 2^320 - 1 (heap storage)
+	const BigInt one_digit = BigInt("18446744073709551615");
+	const BigInt four_digits = (BigInt(1) << 256) - 1;
+	const BigInt five_digits = (BigInt(1) << 320) - 1;
+	for (const BigInt& value : { one_digit, four_digits, five_digits, -five_digits })
+	{
+		BigInt copy(value);
+		EXPECT_EQ(copy, value);
+		BigInt moved(std::move(copy));
+		EXPECT_EQ(moved, value);
+		BigInt assigned = 7;
+		assigned = moved;
+		EXPECT_EQ(assigned, value);
+		assigned = std::move(moved);
+		EXPECT_EQ(assigned, value);
+		EXPECT_EQ(std::string(assigned), std::string(value));
+	}
+	// Values that grow past the inline storage and shrink back
+	BigInt x = four_digits;
+	x += 1;
+	EXPECT_EQ(x, BigInt(1) << 256);
+	x -= 1;
+	EXPECT_EQ(x, four_digits);
+	x *= x;
+	EXPECT_EQ(x, (BigInt(1) << 512) - (BigInt(1) << 257) + 1);
+	x >>= 400;
+	EXPECT_EQ(x, (BigInt(1) << 112) - 1);
+	EXPECT_EQ(-x, BigInt("-5192296858534827628530496329220095"));
+}
+
+TEST(Constructors, MemoryResources) {
+	const BigInt big = (BigInt(1) << 1000) + 12345;
+	BigIntArena arena(1024);
+	BigInt copy;
+	{
+		BigInt kept;
+		{
+			BigIntResourceScope scope(arena);
+			EXPECT_EQ(BigInt::memory_resource(), &arena);
+			BigInt x = big;
+			for (int i = 0; i < 20; ++i)
+				x = x * big % (big + 1);
+			EXPECT_GT(arena.bytes_allocated(), 0u);
+			EXPECT_EQ(x, big);
+			kept = big * big;
+			// Inline values never touch the arena
+			const size_t used = arena.bytes_allocated();
+			BigInt small = 123;
+			small *= small;
+			EXPECT_EQ(arena.bytes_allocated(), used);
+		}
+		EXPECT_EQ(BigInt::memory_resource(), std::pmr::get_default_resource());
+		// The copy takes its digits from the default heap again
+		copy = kept;
+	}
+	arena.reset();
+	EXPECT_EQ(arena.bytes_allocated(), 0u);
+	EXPECT_EQ(copy, big * big);
+	{
+		BigIntResourceScope scope(BigIntArena::thread_local_instance());
+		EXPECT_EQ(pow(BigInt(3), 200) / pow(BigInt(3), 198), BigInt(9));
+	}
+	BigIntArena::thread_local_instance().reset();
+}
+
+TEST(Constructors, MappedStorage) {
+	const BigIntThresholds defaults = BigInt::thresholds();
+	const BigInt a = (BigInt(1) << 40000) - pow(BigInt(3), 5000);
+	const BigInt b = (BigInt(1) << 25000) + pow(BigInt(7), 3000);
+	const BigInt product = a * b;
+	const BigInt square = a * a;
+	BigIntMappedResource mapped("", 4096);
+	EXPECT_FALSE(mapped.directory().empty());
+	EXPECT_THROW(mapped.set_mul_block_limbs(0), std::invalid_argument);
+	mapped.set_mul_block_limbs(64);
+	EXPECT_EQ(BigIntMappedResource::current_mul_block_limbs(), SIZE_MAX);
+	{
+		BigIntResourceScope scope(mapped);
+		EXPECT_EQ(BigIntMappedResource::current_mul_block_limbs(), 64u);
+		BigInt x = a;
+		x += 1;
+		EXPECT_GT(mapped.mapped_bytes(), 0u);
+		EXPECT_EQ(x - 1, a);
+		// Blocks of 64 limbs, some of them short, through every multiplication algorithm
+		BigIntThresholds blocked;
+		blocked.ntt_mul = 16;
+		BigInt::set_thresholds(blocked);
+		EXPECT_EQ(a * b, product);
+		EXPECT_EQ(b * a, product);
+		EXPECT_EQ(a * a, square);
+		EXPECT_EQ((-a) * b, -product);
+		BigInt::set_thresholds(defaults);
+		EXPECT_EQ(a * b, product);
+	}
+	EXPECT_EQ(mapped.mapped_bytes(), 0u);
+}
+
 TEST(ComparisonOperators, Equality) {
 	const BigInt void_val;
 	EXPECT_TRUE(void_val == void_val);
@@ -78,6 +194,31 @@ TEST(ComparisonOperators, LessThanEqual) {
 	EXPECT_TRUE(BigInt("5") <= BigInt("10"));
 }
 
+TEST(ComparisonOperators, Compare) {
+	EXPECT_EQ(compare(BigInt(-10), BigInt(-9)), -1);
+	EXPECT_EQ(compare(BigInt(10), BigInt(-10)), 1);
+	EXPECT_EQ(compare(BigInt(0), BigInt("-0")), 0);
+	EXPECT_EQ(compare(BigInt(1) << 64, BigInt(-1) << 64), 1);
+	// Equal length values differing in a single digit, inside and around every vector width
+	const BigInt base = (BigInt(1) << (64 * 37)) - 1;
+	for (auto level : { bigint_detail::SimdLevel::scalar, bigint_detail::SimdLevel::avx2, bigint_detail::SimdLevel::avx512 })
+	{
+		const auto previous = bigint_detail::set_simd_level(level);
+		for (size_t digit = 0; digit < 37; ++digit)
+		{
+			const BigInt smaller = base - (BigInt(1) << (64 * digit));
+			EXPECT_EQ(compare(smaller, base), -1);
+			EXPECT_EQ(compare(base, smaller), 1);
+			EXPECT_EQ(compare(-smaller, -base), 1);
+			EXPECT_TRUE(smaller < base && smaller <= base && smaller != base);
+			EXPECT_TRUE(-smaller > -base && -smaller >= -base);
+		}
+		EXPECT_EQ(compare(base, BigInt(base)), 0);
+		EXPECT_TRUE(base == BigInt(base) && base <= BigInt(base) && base >= BigInt(base));
+		bigint_detail::set_simd_level(previous);
+	}
+}
+
 TEST(Operators, PositiveAdditions) {
 	BigInt x = 2;
 	x += x;
@@ -111,6 +252,54 @@ TEST(Operators, IncrementDecrementOperators) {
 	EXPECT_EQ(x--, 1);
 }
 
+TEST(Operators, IncrementDecrementCarries) {
+	const BigInt limb = BigInt(1) << 64;
+	BigInt x = limb - 1;
+	EXPECT_EQ(++x, limb);
+	EXPECT_EQ(--x, limb - 1);
+	x = -limb;
+	EXPECT_EQ(++x, -(limb - 1));
+	EXPECT_EQ(--x, -limb);
+	// Crossing zero in both directions
+	x = -2;
+	for (int i = -2; i <= 2; ++i, ++x)
+		EXPECT_EQ(x, i);
+	for (int i = 3; i >= -3; --i, --x)
+		EXPECT_EQ(x, i);
+	EXPECT_EQ(std::string(BigInt(-1) + 1), "0");
+	EXPECT_EQ(std::string(++BigInt(-1)), "0");
+}
+
+TEST(Operators, MixedSignAdditions) {
+	const BigInt small = BigInt(1) << 64;
+	const BigInt large = BigInt(1) << 200;
+	for (const BigInt& a : { small, -small, large, -large, BigInt(0) })
+	{
+		for (const BigInt& b : { small, -small, large, -large, BigInt(0) })
+		{
+			BigInt sum = a;
+			sum += b;
+			BigInt difference = a;
+			difference -= b;
+			EXPECT_EQ(sum - b, a);
+			EXPECT_EQ(difference + b, a);
+			EXPECT_EQ(sum + difference, a + a);
+		}
+	}
+	BigInt x = large;
+	x -= x;
+	EXPECT_EQ(std::string(x), "0");
+	x = -large;
+	x += x;
+	EXPECT_EQ(x, -(large << 1));
+	// Containers relocate their values by moving
+	static_assert(std::is_nothrow_move_constructible<BigInt>::value, "BigInt moves must not throw");
+	std::vector<BigInt> values;
+	for (int i = 0; i < 100; ++i)
+		values.push_back(large + i);
+	EXPECT_EQ(values[99], large + 99);
+}
+
 TEST(Operators, PositiveSubtractions) {
 	BigInt x = 351;
 	x -= x;
@@ -143,6 +332,289 @@ TEST(Operators, Multiplication) {
 	EXPECT_EQ((BigInt(-9) * BigInt(5)), -45);
 }
 
+TEST(Operators, MultiDigitCarries) {
+	EXPECT_EQ((BigInt("18446744073709551615") + BigInt(1)), BigInt("18446744073709551616"));
+	EXPECT_EQ((BigInt("18446744073709551616") - BigInt(1)), BigInt("18446744073709551615"));
+	EXPECT_EQ((BigInt("340282366920938463463374607431768211456") - BigInt(1)), BigInt("340282366920938463463374607431768211455"));
+	EXPECT_EQ((BigInt("18446744073709551615") * BigInt("18446744073709551615")), BigInt("340282366920938463426481119284349108225"));
+	EXPECT_EQ(BigInt(-9223372036854775807LL - 1), BigInt("-9223372036854775808"));
+	EXPECT_TRUE(BigInt("18446744073709551618") < BigInt("36893488147419103233"));
+	EXPECT_TRUE(BigInt("-18446744073709551618") > BigInt("-36893488147419103233"));
+}
+
+TEST(Operators, TemporaryOperands) {
+	const BigInt a = (BigInt(1) << 300) - 1;
+	const BigInt b = BigInt("-123456789012345678901234567890");
+	const BigInt c = BigInt(1) << 130;
+	const BigInt d = 987654321;
+	const BigInt e = -(BigInt(1) << 500);
+	// Same expressions with every operand kept in a named value
+	const BigInt ab = a * b;
+	const BigInt cd = c * d;
+	const BigInt sum = ab + cd;
+	EXPECT_EQ(a * b + c * d - e, sum - e);
+	EXPECT_EQ(e - a * b, e - ab);
+	EXPECT_EQ(d - (c - a), d - c + a);
+	EXPECT_EQ(a * b - c * d, ab - cd);
+	EXPECT_EQ(c * d + a * b, sum);
+	EXPECT_EQ(a - BigInt(a), 0);
+	EXPECT_EQ(BigInt(a) - a, 0);
+	EXPECT_EQ(-(BigInt(a) - a), 0);
+	EXPECT_EQ((a * d) * (b * c), ab * cd);
+	EXPECT_EQ((a + 0) & c, a & c);
+	EXPECT_EQ((c + 0) | d, c | d);
+	EXPECT_EQ((a + 0) ^ a, 0);
+	// The bitwise operators are symmetric, a temporary on either side is reused
+	EXPECT_EQ(c & (a + 0), a & c);
+	EXPECT_EQ(d | (c + 0), c | d);
+	EXPECT_EQ(b ^ (e + 0), b ^ e);
+	EXPECT_EQ(-(a + 0) & (b + 0), -a & b);
+	EXPECT_EQ((b + 0) | -(e + 0), b | -e);
+	EXPECT_EQ((a + 0) ^ (b + 0), a ^ b);
+	// Small integer operands convert to BigInt and keep their sign
+	EXPECT_EQ((a + b) * 2, a + b + a + b);
+	EXPECT_EQ(BigInt("123456789012345678901234567890") * 3, BigInt("370370367037037036703703703670"));
+	EXPECT_EQ(a * -3, -(a + a + a));
+	EXPECT_EQ(-3 * d, BigInt(-2962962963));
+	BigInt x = b;
+	x *= -2;
+	EXPECT_EQ(x, -(b + b));
+	x *= 0;
+	EXPECT_EQ(x, 0);
+	EXPECT_FALSE(x < 0);
+}
+
+TEST(Operators, MultiplyAccumulate) {
+	const BigInt values[] = { 0, 7, -7, BigInt(1) << 64, -(BigInt(1) << 200), (BigInt(1) << 1000) - 1, -pow(BigInt(3), 2500) };
+	for (const BigInt& acc : values)
+	{
+		for (const BigInt& lhs : values)
+		{
+			for (const BigInt& rhs : values)
+			{
+				BigInt x = acc;
+				x.addmul(lhs, rhs);
+				EXPECT_EQ(x, acc + lhs * rhs);
+				x = acc;
+				x.submul(lhs, rhs);
+				EXPECT_EQ(x, acc - lhs * rhs);
+			}
+		}
+		// Aliased accumulator
+		BigInt y = acc;
+		y.addmul(y, y);
+		EXPECT_EQ(y, acc + acc * acc);
+		y = acc;
+		y.submul(y, 3);
+		EXPECT_EQ(y, acc - acc * 3);
+	}
+}
+
+TEST(Operators, MultiplicationAlgorithms) {
+	const BigIntThresholds defaults = BigInt::thresholds();
+	// (2^m - 1) * (2^m + 1) = 2^2m - 1
+	const BigInt a = (BigInt(1) << 9000) - BigInt(1);
+	const BigInt b = (BigInt(1) << 9000) + BigInt(1);
+	const BigInt expected = (BigInt(1) << 18000) - BigInt(1);
+	// Unbalanced operands
+	const BigInt c = (BigInt(1) << 20000) - BigInt("123456789123456789123456789");
+	const BigInt d = (BigInt(1) << 3000) + BigInt(987654321);
+
+	BigIntThresholds schoolbook;
+	schoolbook.karatsuba_mul = 100000;
+	schoolbook.toom3_mul = 100000;
+	BigInt::set_thresholds(schoolbook);
+	EXPECT_EQ(a * b, expected);
+	const BigInt reference = c * d;
+
+	BigIntThresholds karatsuba;
+	karatsuba.karatsuba_mul = 2;
+	karatsuba.toom3_mul = 100000;
+	BigInt::set_thresholds(karatsuba);
+	EXPECT_EQ(a * b, expected);
+	EXPECT_EQ(c * d, reference);
+	EXPECT_EQ(d * c, reference);
+
+	BigIntThresholds toom3;
+	toom3.karatsuba_mul = 4;
+	toom3.toom3_mul = 9;
+	BigInt::set_thresholds(toom3);
+	EXPECT_EQ(a * b, expected);
+	EXPECT_EQ(c * d, reference);
+	EXPECT_EQ((-c) * d, -reference);
+
+	BigIntThresholds ntt;
+	ntt.ntt_mul = 8;
+	BigInt::set_thresholds(ntt);
+	EXPECT_EQ(a * b, expected);
+	EXPECT_EQ(c * d, reference);
+	EXPECT_EQ(d * c, reference);
+	// Squaring goes through a single forward transform
+	EXPECT_EQ(a * a, (BigInt(1) << 18000) - (BigInt(1) << 9001) + BigInt(1));
+	EXPECT_EQ(c * c, c * (c + BigInt(1)) - c);
+
+	BigInt::set_thresholds(defaults);
+}
+
+TEST(Operators, SquaringAlgorithms) {
+	const BigIntThresholds defaults = BigInt::thresholds();
+	std::vector<BigInt> values;
+	for (int digits = 1; digits <= 40; ++digits)
+		values.push_back((BigInt(1) << (64 * digits)) - pow(BigInt(3), 20 * digits));
+	values.push_back((BigInt(1) << 20000) - BigInt("123456789123456789123456789"));
+
+	BigIntThresholds basecase;
+	basecase.karatsuba_sqr = 100000;
+	basecase.toom3_mul = 100000;
+	BigIntThresholds karatsuba;
+	karatsuba.karatsuba_sqr = 2;
+	karatsuba.toom3_mul = 100000;
+	BigIntThresholds toom3;
+	toom3.karatsuba_sqr = 4;
+	toom3.toom3_mul = 9;
+	for (const BigIntThresholds& thresholds : { basecase, karatsuba, toom3 })
+	{
+		BigInt::set_thresholds(thresholds);
+		for (const BigInt& value : values)
+		{
+			// The product with a different operand does not take the squaring path
+			BigInt square = value;
+			square *= value;
+			EXPECT_EQ(square, value * (value + 1) - value);
+		}
+	}
+	BigInt::set_thresholds(defaults);
+}
+
+TEST(Operators, ParallelMultiplication) {
+	const BigIntThresholds defaults = BigInt::thresholds();
+	const BigInt a = (BigInt(1) << 30000) - BigInt("123456789123456789123456789");
+	const BigInt b = (BigInt(1) << 25000) + pow(BigInt(3), 5000);
+	const BigInt product = a * b;
+	const BigInt square = a * a;
+	const BigInt quotient = (product + square) / b;
+
+	BigIntThreadPool pool(4);
+	EXPECT_EQ(pool.size(), 4);
+	EXPECT_EQ(BigInt::set_thread_pool(&pool), nullptr);
+	BigIntThresholds karatsuba;
+	karatsuba.karatsuba_mul = 4;
+	karatsuba.karatsuba_sqr = 4;
+	karatsuba.toom3_mul = 100000;
+	karatsuba.dc_div = 8;
+	karatsuba.parallel_mul = 8;
+	BigIntThresholds toom3 = karatsuba;
+	toom3.toom3_mul = 12;
+	BigIntThresholds ntt = karatsuba;
+	ntt.ntt_mul = 64;
+	for (const BigIntThresholds& thresholds : { karatsuba, toom3, ntt })
+	{
+		BigInt::set_thresholds(thresholds);
+		EXPECT_EQ(a * b, product);
+		EXPECT_EQ(a * a, square);
+		EXPECT_EQ((product + square) / b, quotient);
+	}
+	EXPECT_EQ(BigInt::set_thread_pool(nullptr), &pool);
+	BigInt::set_thresholds(defaults);
+}
+
+// Thread safe resource that remembers its live blocks, and counts the allocations
+// made by threads other than the one that created it
+class RecordingResource : public std::pmr::memory_resource
+{
+public:
+	RecordingResource() : m_owner(std::this_thread::get_id()), m_foreign_allocations(0)
+	{
+	}
+	bool owns(const void* p)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_blocks.count(p) > 0;
+	}
+	int foreign_allocations() const
+	{
+		return m_foreign_allocations.load();
+	}
+
+private:
+	std::thread::id m_owner;
+	std::atomic<int> m_foreign_allocations;
+	std::mutex m_mutex;
+	std::unordered_set<const void*> m_blocks;
+
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		if (std::this_thread::get_id() != m_owner)
+			++m_foreign_allocations;
+		void* const p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_blocks.insert(p);
+		return p;
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_blocks.erase(p);
+		}
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+TEST(Operators, ParallelMemoryResources) {
+	// Two threads share the pool, each with a resource of its own. The tasks take
+	// their digits from the resource of the thread that started them, wherever they run
+	std::vector<BigInt> values;
+	for (int i = 0; i < 400; ++i)
+		values.push_back((BigInt(1) << (42000 + 37 * (i % 11))) - (i + 1));
+	const std::vector<BigInt> expected = mul(values, values);
+	BigIntThreadPool pool(4);
+	BigInt::set_thread_pool(&pool);
+	const auto work = [&values, &expected](int& mismatches, int& strays, int& foreign_allocations)
+	{
+		RecordingResource resource;
+		{
+			BigIntResourceScope scope(resource);
+			for (int round = 0; round < 5; ++round)
+			{
+				const std::vector<BigInt> products = mul(values, values);
+				if (products != expected)
+					++mismatches;
+				for (const BigInt& product : products)
+				{
+					if (!resource.owns(BigIntView(product).data()))
+						++strays;
+				}
+			}
+		}
+		foreign_allocations = resource.foreign_allocations();
+	};
+	int mismatches[2] = { 0, 0 };
+	int strays[2] = { 0, 0 };
+	int foreign_allocations[2] = { 0, 0 };
+	std::thread other(work, std::ref(mismatches[1]), std::ref(strays[1]), std::ref(foreign_allocations[1]));
+	work(mismatches[0], strays[0], foreign_allocations[0]);
+	other.join();
+	EXPECT_EQ(mismatches[0] + mismatches[1], 0);
+	EXPECT_EQ(strays[0], 0);
+	EXPECT_EQ(strays[1], 0);
+	// The workers took some of the tasks, and allocated from the callers' resources
+	EXPECT_GT(foreign_allocations[0] + foreign_allocations[1], 0);
+
+	// The workers share the arena of the caller
+	BigIntArena arena;
+	{
+		BigIntResourceScope scope(arena);
+		EXPECT_EQ(mul(values, values), expected);
+	}
+	arena.reset();
+	BigInt::set_thread_pool(nullptr);
+}
+
 TEST(Operators, Division) {
 	EXPECT_EQ((BigInt("99999999999999999999") / BigInt(1)), BigInt("99999999999999999999"));
 	EXPECT_EQ((BigInt(10) / BigInt(9)), 1);
@@ -159,6 +631,46 @@ TEST(Operators, Division) {
 	EXPECT_ANY_THROW((BigInt(89) / BigInt(0)));
 }
 
+TEST(Operators, MultiDigitDivision) {
+	const BigInt dividend = (BigInt(1) << 100) + BigInt(12345);
+	const BigInt divisor = (BigInt(1) << 70) + BigInt(7);
+	EXPECT_EQ(dividend / divisor, BigInt("1073741823"));
+	EXPECT_EQ(dividend % divisor, BigInt("1180591620709895123008"));
+}
+
+TEST(Operators, DivisionAlgorithms) {
+	const BigIntThresholds defaults = BigInt::thresholds();
+	const BigInt divisor = (BigInt(1) << 8000) - BigInt("98765432109876543210");
+	const BigInt quotient = (BigInt(1) << 9500) - BigInt(1);
+	const BigInt remainder = divisor - BigInt(1);
+	const BigInt dividend = divisor * quotient + remainder;
+
+	BigIntThresholds schoolbook;
+	schoolbook.dc_div = 100000;
+	BigInt::set_thresholds(schoolbook);
+	EXPECT_EQ(dividend / divisor, quotient);
+	EXPECT_EQ(dividend % divisor, remainder);
+
+	BigIntThresholds recursive;
+	recursive.dc_div = 4;
+	BigInt::set_thresholds(recursive);
+	EXPECT_EQ(dividend / divisor, quotient);
+	EXPECT_EQ(dividend % divisor, remainder);
+	EXPECT_EQ((-dividend) / divisor, -quotient);
+
+	BigInt::set_thresholds(defaults);
+}
+
+TEST(Operators, DivMod) {
+	const auto result = divmod(BigInt(100), BigInt(7));
+	EXPECT_EQ(result.first, 14);
+	EXPECT_EQ(result.second, 2);
+	const auto negative = divmod(BigInt(-3), BigInt(2));
+	EXPECT_EQ(negative.first, BigInt(-3) / BigInt(2));
+	EXPECT_EQ(negative.second, BigInt(-3) % BigInt(2));
+	EXPECT_ANY_THROW(divmod(BigInt(1), BigInt(0)));
+}
+
 TEST(Operators, Modulo) {
 	EXPECT_EQ((BigInt(100) % BigInt(97)), 3);
 	EXPECT_EQ((BigInt(100) % BigInt(100)), 0);
@@ -180,11 +692,279 @@ TEST(Math, Power) {
 	EXPECT_EQ(pow(BigInt(1), 8), 1);
 	EXPECT_EQ(pow(BigInt(0), 8), 0);
 	EXPECT_EQ(pow(BigInt(0), BigInt(2)), 0);
-	EXPECT_EQ(pow(BigInt(3), BigInt(3)), 81);
+	EXPECT_EQ(pow(BigInt(3), BigInt(3)), 27);
 	EXPECT_EQ(pow(BigInt(3), BigInt(0)), 1);
 	EXPECT_ANY_THROW(pow(BigInt(2), -1));
 }
 
+TEST(Math, PowerAlgorithms) {
+	// Every window layout against repeated multiplication
+	for (const BigInt& base : { BigInt(3), BigInt(-7), BigInt(12), BigInt("-98765432109876543210") })
+	{
+		BigInt expected = 1;
+		for (int exponent = 0; exponent < 80; ++exponent)
+		{
+			EXPECT_EQ(pow(base, exponent), expected);
+			expected *= base;
+		}
+	}
+	const BigInt x = BigInt("123456789123456789");
+	EXPECT_EQ(pow(x, 1234), pow(x, 1000) * pow(x, 234));
+	EXPECT_EQ(pow(x, BigInt(4321)), pow(pow(x, 29), 149));
+	// Powers of two (and their odd multiples) are shifts
+	EXPECT_EQ(pow(BigInt(2), 100000), BigInt(1) << 100000);
+	EXPECT_EQ(pow(BigInt(-4), 3333), -(BigInt(1) << 6666));
+	EXPECT_EQ(pow(BigInt(1) << 100, 50), BigInt(1) << 5000);
+	EXPECT_EQ(pow(BigInt(24), 500), pow(BigInt(3), 500) << 1500);
+	// Units accept any exponent, other bases throw before running out of memory
+	const BigInt huge = BigInt(1) << 200;
+	EXPECT_EQ(pow(BigInt(1), huge), 1);
+	EXPECT_EQ(pow(BigInt(-1), huge), 1);
+	EXPECT_EQ(pow(BigInt(-1), huge + 1), -1);
+	EXPECT_EQ(pow(BigInt(0), huge), 0);
+	EXPECT_THROW(pow(BigInt(2), huge), std::length_error);
+}
+
+TEST(Math, ModularExponentiation) {
+	const auto residue = [](const BigInt& x, const BigInt& m)
+	{
+		BigInt r = x % m;
+		return r < 0 ? r + m : r;
+	};
+	// Odd moduli take the Montgomery path, even ones the Barrett path
+	const BigInt odd = BigInt("340282366920938463463374607431768211507");
+	const BigInt even = BigInt("1267650600228229401496703205376") * 3;
+	for (const BigInt& m : { odd, even, BigInt(97), BigInt(1000), BigInt(1) << 64 })
+	{
+		for (const BigInt& base : { BigInt(0), BigInt(2), BigInt(-3), BigInt("98765432109876543210987654321") })
+		{
+			for (int exponent : { 0, 1, 2, 7, 64, 131, 500 })
+			{
+				EXPECT_EQ(powmod(base, exponent, m), residue(pow(base, exponent), m));
+			}
+		}
+	}
+	// Fermat on the Mersenne prime 2^127 - 1
+	const BigInt p = (BigInt(1) << 127) - 1;
+	EXPECT_EQ(powmod(BigInt("123456789123456789123456789"), p - 1, p), 1);
+	EXPECT_EQ(powmod(BigInt(5), p, p), 5);
+	// One context, many operations
+	const Modulus modulus(even);
+	const BigInt a = BigInt("-123456789123456789123456789123456789");
+	const BigInt b = BigInt("987654321987654321987654321987654321");
+	EXPECT_EQ(modulus.reduce(a), residue(a, even));
+	EXPECT_EQ(modulus.mul(a, b), residue(a * b, even));
+	EXPECT_EQ(modulus.pow(a, BigInt(12345)), residue(modulus.pow(a, BigInt(12344)) * a, even));
+	EXPECT_EQ(powmod(BigInt(7), BigInt(3), BigInt(1)), 0);
+	EXPECT_THROW(Modulus(BigInt(0)), std::domain_error);
+	EXPECT_THROW(powmod(BigInt(2), BigInt(3), BigInt(-5)), std::domain_error);
+	EXPECT_THROW(powmod(BigInt(2), BigInt(-3), BigInt(5)), std::domain_error);
+}
+
+TEST(Math, BatchOperations) {
+	std::vector<BigInt> values;
+	BigInt expected_sum = 0;
+	BigInt expected_product = 1;
+	for (int i = 0; i < 300; ++i)
+	{
+		// Mixed signs and sizes, with runs of carries
+		BigInt value = (BigInt(1) << (64 * (i % 7) + i)) - BigInt(1);
+		if (i % 3 == 0)
+			value = -value;
+		values.push_back(value);
+		expected_sum += value;
+		expected_product *= value;
+	}
+	EXPECT_EQ(sum(values), expected_sum);
+	EXPECT_EQ(product(values), expected_product);
+	EXPECT_EQ(sum(std::vector<BigInt>()), 0);
+	EXPECT_EQ(product(std::vector<BigInt>()), 1);
+	EXPECT_EQ(sum(std::vector<BigInt>{ BigInt(5), BigInt(-5) }), 0);
+	EXPECT_EQ(sum(std::vector<BigInt>{ BigInt(-7), BigInt(2) }), -5);
+
+	std::vector<BigInt> reversed(values.rbegin(), values.rend());
+	const std::vector<BigInt> sums = add(values, reversed);
+	const std::vector<BigInt> products = mul(values, reversed);
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		EXPECT_EQ(sums[i], values[i] + reversed[i]);
+		EXPECT_EQ(products[i], values[i] * reversed[i]);
+	}
+	// In place
+	add(reversed.data(), values.data(), reversed.data(), values.size());
+	EXPECT_EQ(reversed, sums);
+	EXPECT_THROW(add(values, std::vector<BigInt>(3)), std::invalid_argument);
+
+	// The same results when spread over a pool
+	const BigIntThresholds defaults = BigInt::thresholds();
+	BigIntThresholds thresholds;
+	thresholds.parallel_mul = 8;
+	BigInt::set_thresholds(thresholds);
+	BigIntThreadPool pool(3);
+	BigInt::set_thread_pool(&pool);
+	std::vector<BigInt> many;
+	for (int i = 0; i < 200; ++i)
+		many.insert(many.end(), values.begin(), values.end());
+	EXPECT_EQ(sum(many), expected_sum * 200);
+	EXPECT_EQ(product(values), expected_product);
+	EXPECT_EQ(mul(many, many)[1234], values[34] * values[34]);
+	BigInt::set_thread_pool(nullptr);
+	BigInt::set_thresholds(defaults);
+}
+
+TEST(Math, RemainderTree) {
+	std::vector<BigInt> moduli;
+	for (int i = 1; i <= 101; ++i)
+		moduli.push_back(pow(BigInt(7), 3 * i) + BigInt(i));
+	const ProductTree tree(moduli);
+	EXPECT_EQ(tree.size(), moduli.size());
+	EXPECT_EQ(tree.product(), product(moduli));
+	for (const BigInt& x : { pow(BigInt(3), 20000) + BigInt(17), -pow(BigInt(5), 9000), BigInt(0), BigInt(12345) })
+	{
+		const std::vector<BigInt> residues = tree.remainders(x);
+		ASSERT_EQ(residues.size(), moduli.size());
+		for (size_t i = 0; i < moduli.size(); ++i)
+		{
+			const BigInt expected = x % moduli[i];
+			EXPECT_EQ(residues[i], expected < 0 ? expected + moduli[i] : expected);
+		}
+	}
+	EXPECT_EQ(ProductTree(std::vector<BigInt>()).product(), 1);
+	EXPECT_THROW(ProductTree(std::vector<BigInt>{ BigInt(3), BigInt(0) }), std::domain_error);
+
+	// Moduli sharing primes, like RSA keys from a weak generator
+	const BigInt p = (BigInt(1) << 127) - 1;
+	const BigInt q = (BigInt(1) << 89) - 1;
+	const BigInt r = (BigInt(1) << 107) - 1;
+	const BigInt s = (BigInt(1) << 61) - 1;
+	const std::vector<BigInt> gcds = batch_gcd({ p * q, q * r, s * BigInt(1000003), p * s, BigInt(101) * BigInt(103) });
+	const std::vector<BigInt> expected = { p * q, q, s, p * s, 1 };
+	EXPECT_EQ(gcds, expected);
+}
+
+TEST(Math, Gcd) {
+	EXPECT_EQ(gcd(BigInt(0), BigInt(0)), 0);
+	EXPECT_EQ(gcd(BigInt(0), BigInt(-12)), 12);
+	EXPECT_EQ(gcd(BigInt(-84), BigInt(36)), 12);
+	EXPECT_EQ(lcm(BigInt(-4), BigInt(6)), 12);
+	EXPECT_EQ(lcm(BigInt(0), BigInt(6)), 0);
+	EXPECT_EQ(modinv(BigInt(-3), BigInt(7)), 2);
+	EXPECT_THROW(modinv(BigInt(6), BigInt(9)), std::domain_error);
+	EXPECT_THROW(modinv(BigInt(2), BigInt(-7)), std::domain_error);
+
+	// Lehmer steps, then also the half-gcd recursion
+	const BigIntThresholds defaults = BigInt::thresholds();
+	BigIntThresholds low = defaults;
+	low.hgcd = 4;
+	const BigInt g = pow(BigInt(3), 700) + BigInt(2);
+	const BigInt a = g * (pow(BigInt(5), 2000) + BigInt(1));
+	const BigInt b = -g * (pow(BigInt(7), 1500) - BigInt(4));
+	for (const BigIntThresholds& thresholds : { defaults, low })
+	{
+		BigInt::set_thresholds(thresholds);
+		EXPECT_EQ(gcd(a, b), g);
+		EXPECT_EQ(gcd(b, a), g);
+		EXPECT_EQ(gcd(a, g), g);
+		EXPECT_EQ(lcm(a, b), a / g * -b);
+		BigInt d, x, y;
+		std::tie(d, x, y) = extended_gcd(a, b);
+		EXPECT_EQ(d, g);
+		EXPECT_EQ(a * x + b * y, g);
+		EXPECT_LE((x < 0 ? -x : x) << 1, -b / g);
+		const BigInt p = (BigInt(1) << 521) - 1;
+		EXPECT_EQ(modinv(a, p) * a % p, 1);
+	}
+	BigInt::set_thresholds(defaults);
+}
+
+TEST(Math, FixedWidth) {
+	typedef FixedBigInt<256> U256;
+	// Folded at compile time
+	constexpr U256 p("0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff");
+	constexpr U256 divisor("12345678901234567890123456789");
+	static_assert(divisor * (p / divisor) + p % divisor == p, "");
+	static_assert(((p + 1) >> 1 << 1) == p + 1, "");
+	static_assert(U256(-1) == ~U256(0) && -U256(5) + 5 == 0, "");
+	static_assert(full_product(U256(-1), U256(-1)) == FixedBigInt<512>(0) - (FixedBigInt<512>(1) << 257) + 1, "");
+
+	// Same results as BigInt, modulo 2^256
+	const BigInt modulus = BigInt(1) << 256;
+	const BigInt a = BigInt("98765432109876543210987654321098765432109876543210987654321098765432109876543");
+	const BigInt b = (BigInt(1) << 255) + BigInt("123456789012345678901234567890");
+	const U256 x(a), y(b);
+	EXPECT_EQ(x.to_bigint(), a);
+	EXPECT_EQ((x + y).to_bigint(), (a + b) % modulus);
+	EXPECT_EQ((y - x).to_bigint(), b - a + modulus);
+	EXPECT_EQ((x * y).to_bigint(), a * b % modulus);
+	EXPECT_EQ(full_product(x, y).to_bigint(), a * b);
+	EXPECT_EQ((x / (y >> 100)).to_bigint(), a / (b >> 100));
+	EXPECT_EQ((x % (y >> 100)).to_bigint(), a % (b >> 100));
+	EXPECT_EQ((x / 7).to_bigint(), a / 7);
+	EXPECT_EQ((x << 70).to_bigint(), (a << 70) % modulus);
+	EXPECT_EQ((x >> 70).to_bigint(), a >> 70);
+	EXPECT_EQ((x >> 256).to_bigint(), 0);
+	EXPECT_EQ((x & y).to_bigint(), a & b);
+	EXPECT_EQ((x | (y ^ x)).to_bigint(), a | (b ^ a));
+	EXPECT_TRUE(y < x && x > y && x != y && x <= x);
+	EXPECT_EQ(U256(static_cast<std::string>(a).c_str()), x);
+	EXPECT_EQ(FixedBigInt<512>(x).to_bigint(), a);
+	EXPECT_EQ(FixedBigInt<128>(x).to_bigint(), a % (BigInt(1) << 128));
+
+	EXPECT_THROW(x / U256(0), std::runtime_error);
+	EXPECT_THROW(U256(-a), std::domain_error);
+	EXPECT_THROW(U256 fixed(modulus), std::length_error);
+	EXPECT_THROW(U256("0x1" "0000000000000000000000000000000000000000000000000000000000000000"), std::length_error);
+	EXPECT_THROW(U256("12a"), std::invalid_argument);
+	EXPECT_THROW(U256(""), std::invalid_argument);
+}
+
+TEST(Math, ConstantTime) {
+	const BigInt a = BigInt("115792089237316195423570985008687907853269984665640564039457584007913129639935");
+	const BigInt b = BigInt("98765432109876543210987654321");
+	ConstantTimeInt x(a, 4), y(b, 4), r(4);
+	// Fixed widths wrap around, the carries come out
+	EXPECT_EQ(constant_time::add(r, x, y), 1u);
+	EXPECT_EQ(r.to_bigint(), a + b - (BigInt(1) << 256));
+	EXPECT_EQ(constant_time::sub(r, y, x), 1u);
+	EXPECT_EQ(r.to_bigint(), b - a + (BigInt(1) << 256));
+	EXPECT_EQ(constant_time::sub(r, x, y), 0u);
+	EXPECT_EQ(r.to_bigint(), a - b);
+	EXPECT_EQ(constant_time::mul(x, y).to_bigint(), a * b);
+	EXPECT_EQ(constant_time::mul(x, x).size(), 8u);
+	EXPECT_EQ(constant_time::mul(x, x).to_bigint(), a * a);
+	EXPECT_EQ(constant_time::compare(x, y), 1);
+	EXPECT_EQ(constant_time::compare(y, x), -1);
+	EXPECT_EQ(constant_time::compare(x, ConstantTimeInt(a, 4)), 0);
+	EXPECT_TRUE(constant_time::equal(x, ConstantTimeInt(a, 4)));
+	EXPECT_FALSE(constant_time::equal(x, y));
+	constant_time::conditional_swap(x, y, 0);
+	EXPECT_EQ(x.to_bigint(), a);
+	constant_time::conditional_swap(x, y, 1);
+	EXPECT_EQ(x.to_bigint(), b);
+	EXPECT_EQ(y.to_bigint(), a);
+	EXPECT_THROW(constant_time::compare(x, ConstantTimeInt(3)), std::invalid_argument);
+	EXPECT_THROW(ConstantTimeInt(a, 3), std::length_error);
+	EXPECT_THROW(ConstantTimeInt(-a, 4), std::domain_error);
+
+	// Same results as the variable time modular arithmetic
+	const BigInt p = (BigInt(1) << 127) - 1;
+	for (const BigInt& m : { p, BigInt(1000003), (BigInt(1) << 521) - 1 })
+	{
+		const ConstantTimeModulus modulus(m);
+		const size_t n = modulus.size();
+		const ConstantTimeInt base(b % m, n);
+		const ConstantTimeInt other(a % m, n);
+		const ConstantTimeInt product = modulus.montgomery_mul(modulus.to_montgomery(base), modulus.to_montgomery(other));
+		EXPECT_EQ(modulus.from_montgomery(product).to_bigint(), (b % m) * (a % m) % m);
+		for (const BigInt& e : { BigInt(0), BigInt(1), BigInt(65537), p - 1, a })
+		{
+			EXPECT_EQ(modulus.pow(base, ConstantTimeInt(e, 4)).to_bigint(), powmod(b, e, m));
+		}
+	}
+	EXPECT_THROW(ConstantTimeModulus(BigInt(1) << 64), std::domain_error);
+	EXPECT_THROW(ConstantTimeModulus(BigInt(1)), std::domain_error);
+}
+
 TEST(Conversions, ToString) {
 	BigInt x = 129;
 	std::string s_x = x;
@@ -194,6 +974,235 @@ TEST(Conversions, ToString) {
 	EXPECT_STREQ(s_y.c_str(), "-9129");
 }
 
+TEST(Conversions, LargeValues)
+{
+	const BigIntThresholds defaults = BigInt::thresholds();
+	std::string digits = "9";
+	for (int i = 0; i < 400; ++i)
+	{
+		digits += std::to_string(i * 7919 % 1000000);
+	}
+	// 10^k is a one followed by k zeros whatever chunk or split boundary k falls on
+	const std::string power = "1" + std::string(1000, '0');
+	for (size_t dc_radix : { 2, 100000 })
+	{
+		BigIntThresholds thresholds;
+		thresholds.dc_radix = dc_radix;
+		BigInt::set_thresholds(thresholds);
+		EXPECT_EQ(static_cast<std::string>(BigInt(digits)), digits);
+		EXPECT_EQ(static_cast<std::string>(BigInt("-" + digits)), "-" + digits);
+		EXPECT_EQ(BigInt(power), pow(BigInt(10), 1000));
+		EXPECT_EQ(static_cast<std::string>(pow(BigInt(10), 1000)), power);
+		EXPECT_EQ(BigInt("000000000000000000000000000042"), 42);
+	}
+	BigInt::set_thresholds(defaults);
+}
+
+TEST(Conversions, Streams)
+{
+	const BigIntThresholds defaults = BigInt::thresholds();
+	// More digits than three blocks of operator>>, which merge, and a partial block
+	std::string digits = "8";
+	for (int i = 0; digits.size() < 3 * 19456 + 777; ++i)
+		digits += std::to_string(i * 104729 % 1000000007);
+	const BigInt big(digits);
+
+	std::ostringstream out;
+	out << big << ' ' << -big << ' ' << BigInt(0);
+	out.width(6);
+	out << BigInt(-42);
+	EXPECT_EQ(out.str(), digits + " -" + digits + " 0   -42");
+	BigIntThresholds split;
+	split.dc_radix = 2;
+	BigInt::set_thresholds(split);
+	std::ostringstream split_out;
+	split_out << pow(BigInt(10), 1000);
+	EXPECT_EQ(split_out.str(), "1" + std::string(1000, '0'));
+	BigInt::set_thresholds(defaults);
+
+	std::istringstream in(digits + "  -" + digits + "\n+17 -0 0042x -");
+	BigInt x;
+	BigInt y;
+	in >> x >> y;
+	EXPECT_EQ(x, big);
+	EXPECT_EQ(y, -big);
+	in >> x;
+	EXPECT_EQ(x, 17);
+	in >> x;
+	EXPECT_EQ(x, 0);
+	EXPECT_FALSE(x < 0);
+	in >> x;
+	EXPECT_EQ(x, 42);
+	EXPECT_EQ(in.get(), 'x');
+	EXPECT_TRUE(in.good());
+	in >> x;
+	EXPECT_TRUE(in.fail());
+	EXPECT_TRUE(in.eof());
+	EXPECT_EQ(x, 42);
+	std::istringstream last("123");
+	last >> x;
+	EXPECT_EQ(x, 123);
+	EXPECT_TRUE(last.eof());
+	EXPECT_FALSE(last.fail());
+}
+
+TEST(Conversions, Chars)
+{
+	const BigInt big = -pow(BigInt(3), 500);
+	const std::string text = big;
+	std::vector<char> buffer(text.size());
+	const std::to_chars_result written = to_chars(buffer.data(), buffer.data() + buffer.size(), big);
+	EXPECT_EQ(written.ec, std::errc());
+	EXPECT_EQ(std::string(buffer.data(), written.ptr), text);
+	const std::to_chars_result small = to_chars(buffer.data(), buffer.data() + buffer.size() - 1, big);
+	EXPECT_EQ(small.ec, std::errc::value_too_large);
+	EXPECT_EQ(small.ptr, buffer.data() + buffer.size() - 1);
+	char zero[1];
+	EXPECT_EQ(to_chars(zero, zero + 1, BigInt(0)).ptr, zero + 1);
+	EXPECT_EQ(zero[0], '0');
+
+	BigInt value;
+	const std::from_chars_result read = from_chars(text.data(), text.data() + text.size(), value);
+	EXPECT_EQ(read.ec, std::errc());
+	EXPECT_EQ(read.ptr, text.data() + text.size());
+	EXPECT_EQ(value, big);
+	const std::string mixed = "-123,456";
+	EXPECT_EQ(from_chars(mixed.data(), mixed.data() + mixed.size(), value).ptr, mixed.data() + 4);
+	EXPECT_EQ(value, -123);
+	const std::string zeros = "-" + std::string(30, '0');
+	from_chars(zeros.data(), zeros.data() + zeros.size(), value);
+	EXPECT_EQ(value, 0);
+	EXPECT_FALSE(value < 0);
+	const std::string invalid = "+1";
+	const std::from_chars_result failed = from_chars(invalid.data(), invalid.data() + invalid.size(), value);
+	EXPECT_EQ(failed.ec, std::errc::invalid_argument);
+	EXPECT_EQ(failed.ptr, invalid.data());
+	EXPECT_EQ(value, 0);
+}
+
+TEST(Conversions, Bytes)
+{
+	// 0x0102030405060708090a0b
+	const BigInt x = (BigInt(0x010203) << 64) | BigInt(0x0405060708090a0bLL);
+	const auto bytes = [](std::initializer_list<int> values)
+	{
+		std::vector<std::byte> result;
+		for (int value : values)
+			result.push_back(static_cast<std::byte>(value));
+		return result;
+	};
+	const auto exported = [&x](Endian word_order, size_t word_size, Endian byte_order)
+	{
+		std::vector<std::byte> out(x.byte_size(word_size));
+		EXPECT_EQ(x.to_bytes(out.data(), out.size(), word_order, word_size, byte_order), out.size());
+		EXPECT_EQ(BigInt::from_bytes(out.data(), out.size(), word_order, word_size, byte_order), x);
+		return out;
+	};
+	EXPECT_EQ(x.byte_size(), 11u);
+	EXPECT_EQ(exported(Endian::big, 1, Endian::big), bytes({ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }));
+	EXPECT_EQ(exported(Endian::little, 1, Endian::big), bytes({ 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 }));
+	EXPECT_EQ(exported(Endian::big, 4, Endian::big), bytes({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 }));
+	EXPECT_EQ(exported(Endian::little, 4, Endian::big), bytes({ 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 }));
+	EXPECT_EQ(exported(Endian::big, 4, Endian::little), bytes({ 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8 }));
+	EXPECT_EQ(exported(Endian::big, 8, Endian::little), bytes({ 3, 2, 1, 0, 0, 0, 0, 0, 11, 10, 9, 8, 7, 6, 5, 4 }));
+	EXPECT_EQ(exported(Endian::little, 8, Endian::big), bytes({ 4, 5, 6, 7, 8, 9, 10, 11, 0, 0, 0, 0, 0, 1, 2, 3 }));
+	EXPECT_EQ(exported(Endian::native, 8, Endian::native).size(), 16u);
+
+	// The magnitude only, zero takes no bytes
+	std::vector<std::byte> out(16);
+	EXPECT_EQ((-x).to_bytes(out.data(), out.size()), 11u);
+	EXPECT_EQ(BigInt::from_bytes(out.data(), 11), x);
+	EXPECT_EQ(BigInt(0).byte_size(8), 0u);
+	EXPECT_EQ(BigInt::from_bytes(out.data(), 0), 0);
+	EXPECT_THROW(x.to_bytes(out.data(), 10), std::length_error);
+	EXPECT_THROW(BigInt::from_bytes(out.data(), 11, Endian::big, 4), std::invalid_argument);
+	EXPECT_THROW(x.byte_size(0), std::invalid_argument);
+
+	// Views read the limbs in place
+	const uint64_t limbs[] = { 0x0405060708090a0bULL, 0x010203, 0, 0 };
+	const BigIntView view(limbs, 4);
+	EXPECT_EQ(view.size(), 2u);
+	EXPECT_EQ(view.data(), limbs);
+	EXPECT_EQ(view.to_bigint(), x);
+	EXPECT_TRUE(view == BigIntView(x));
+	EXPECT_EQ(BigIntView(limbs, 4, true).to_bigint(), -x);
+	EXPECT_EQ(compare(BigIntView(limbs, 4, true), BigIntView(x)), -1);
+	EXPECT_EQ(compare(BigIntView(limbs, 1), BigIntView(x)), -1);
+	EXPECT_TRUE(BigIntView(limbs + 2, 2, true).is_zero());
+	EXPECT_FALSE(BigIntView(limbs + 2, 2, true).is_negative());
+	EXPECT_EQ(view.to_bytes(out.data(), out.size()), 11u);
+	EXPECT_EQ(BigInt::from_bytes(out.data(), 11), x);
+}
+
+TEST(Conversions, Serialization)
+{
+	const std::vector<BigInt> values = { 0, 1, -1, 63, 64, -300, pow(BigInt(2), 503) - 1, -pow(BigInt(2), 503), pow(BigInt(7), 5000) };
+	// Small values take a byte or two
+	EXPECT_EQ(BigIntWriter::encoded_size(0), 1u);
+	EXPECT_EQ(BigIntWriter::encoded_size(-1), 2u);
+	EXPECT_EQ(BigIntWriter::encoded_size(pow(BigInt(2), 503) - 1), 64u);
+	EXPECT_EQ(BigIntWriter::encoded_size(pow(BigInt(2), 504)), 66u);
+	std::byte encoded[3] = {};
+	EXPECT_EQ(BigIntWriter::encode(-300, encoded), 3u);
+	EXPECT_EQ(encoded[0], std::byte{ 5 });
+	EXPECT_EQ(encoded[1], std::byte{ 0x2c });
+	EXPECT_EQ(encoded[2], std::byte{ 1 });
+
+	// A buffer smaller than some values
+	std::stringstream stream;
+	{
+		BigIntWriter writer(stream, 16);
+		writer.write(values);
+		writer.write(values.data(), 2);
+	}
+	const std::string bytes = stream.str();
+	size_t total = 0;
+	for (const BigInt& value : values)
+		total += BigIntWriter::encoded_size(value);
+	EXPECT_EQ(bytes.size(), total + BigIntWriter::encoded_size(0) + BigIntWriter::encoded_size(1));
+
+	BigIntReader memory(reinterpret_cast<const std::byte*>(bytes.data()), bytes.size());
+	EXPECT_TRUE(memory.skip());
+	BigInt value;
+	EXPECT_TRUE(memory.next(value));
+	EXPECT_EQ(value, 1);
+	std::vector<BigInt> rest(values.size());
+	EXPECT_EQ(memory.read(rest.data(), rest.size()), values.size());
+	EXPECT_EQ(std::vector<BigInt>(rest.begin(), rest.end() - 2), std::vector<BigInt>(values.begin() + 2, values.end()));
+	EXPECT_FALSE(memory.next(value));
+	EXPECT_FALSE(memory.skip());
+
+	BigIntReader streamed(stream, 16);
+	std::vector<BigInt> expected = values;
+	expected.insert(expected.end(), values.begin(), values.begin() + 2);
+	EXPECT_EQ(streamed.read_all(), expected);
+
+	// Truncated value, header without its end
+	BigIntReader truncated(reinterpret_cast<const std::byte*>(bytes.data()), bytes.size() - 1);
+	EXPECT_THROW(truncated.read_all(), std::invalid_argument);
+	const std::byte header[] = { std::byte{ 0x80 }, std::byte{ 0x80 } };
+	EXPECT_THROW(BigIntReader::decode(header, 2, value), std::invalid_argument);
+
+	// A corrupt header announcing 2^60 bytes fails once the stream ends, whatever it claims
+	const std::string oversized = std::string(8, '\x80') + '\x20' + std::string(100, '\x01');
+	std::istringstream oversized_stream(oversized);
+	BigIntReader oversized_reader(oversized_stream, 16);
+	EXPECT_THROW(oversized_reader.next(value), std::invalid_argument);
+	std::istringstream oversized_skipped(oversized);
+	BigIntReader skipping_reader(oversized_skipped, 16);
+	EXPECT_THROW(skipping_reader.skip(), std::invalid_argument);
+	// Values longer than the buffer are skipped in the stream
+	std::istringstream skipped(bytes);
+	BigIntReader skipping(skipped, 16);
+	for (size_t i = 0; i < values.size(); ++i)
+		EXPECT_TRUE(skipping.skip());
+	EXPECT_TRUE(skipping.next(value));
+	EXPECT_EQ(value, 0);
+	EXPECT_TRUE(skipping.next(value));
+	EXPECT_EQ(value, 1);
+	EXPECT_FALSE(skipping.skip());
+}
+
 TEST(Bitwise, And)
 {
 	EXPECT_EQ(BigInt(123) & BigInt(122), 122);
@@ -241,4 +1250,102 @@ TEST(Bitwise, RightShift)
 	BigInt xt = 1;
 	xt <<= 70;
 	EXPECT_EQ(xt >> 68, 4);
+}
+
+TEST(Bitwise, SimdKernels)
+{
+	using bigint_detail::SimdLevel;
+	// Operands of every length around the vector widths, against the scalar kernels
+	std::vector<BigInt> values;
+	BigInt value = BigInt("12345678901234567890123456789");
+	for (int i = 0; i < 40; ++i)
+	{
+		values.push_back(value);
+		value = value * BigInt("98765432109876543211") + BigInt(i);
+	}
+	const auto results = [&values]()
+	{
+		std::vector<BigInt> out;
+		for (size_t i = 0; i + 1 < values.size(); ++i)
+		{
+			const BigInt& a = values[i + 1];
+			const BigInt& b = values[i];
+			out.insert(out.end(), { a & b, a | b, a ^ b, b & a, b | a, b ^ a });
+			for (size_t shift : { 1, 17, 63, 64, 65, 200, 513 })
+			{
+				out.push_back(a << shift);
+				out.push_back(a >> shift);
+			}
+		}
+		return out;
+	};
+	const SimdLevel previous = bigint_detail::set_simd_level(SimdLevel::scalar);
+	EXPECT_EQ(bigint_detail::simd_level(), SimdLevel::scalar);
+	const std::vector<BigInt> expected = results();
+	for (SimdLevel level : { SimdLevel::avx2, SimdLevel::avx512 })
+	{
+		bigint_detail::set_simd_level(level);
+		EXPECT_EQ(results(), expected);
+	}
+	bigint_detail::set_simd_level(previous);
+	// Shifts agree with the arithmetic
+	const BigInt& a = values.back();
+	EXPECT_EQ(a << 1000, a * pow(BigInt(2), 1000));
+	EXPECT_EQ(a >> 333, a / pow(BigInt(2), 333));
+	EXPECT_EQ((a << 64) >> 64, a);
+	EXPECT_EQ(BigInt(0) << 1000, 0);
+	EXPECT_EQ((a | (a << 5000)) & a, a);
+	EXPECT_EQ((a ^ (a << 5000)) >> 5000, a);
+}
+
+TEST(Bitwise, TwosComplement)
+{
+	// Negative operands behave like the built in integers
+	for (long long x = -70; x <= 70; x += 3)
+	{
+		for (long long y = -70; y <= 70; y += 7)
+		{
+			EXPECT_EQ(BigInt(x) & BigInt(y), x & y);
+			EXPECT_EQ(BigInt(x) | BigInt(y), x | y);
+			EXPECT_EQ(BigInt(x) ^ BigInt(y), x ^ y);
+		}
+		EXPECT_EQ(~BigInt(x), ~x);
+		for (int shift : { 0, 1, 3, 6, 63 })
+		{
+			EXPECT_EQ(BigInt(x) >> shift, x >> shift);
+		}
+	}
+	EXPECT_EQ(BigInt(-1) >> 1000, -1);
+	EXPECT_EQ(BigInt(LLONG_MIN) & BigInt(LLONG_MAX), 0);
+	EXPECT_EQ(BigInt(LLONG_MIN) ^ BigInt(-1), LLONG_MAX);
+	// Beyond the digit size: identities of the infinite representations
+	const BigInt a = -BigInt("340282366920938463463374607431768211456123456789");
+	const BigInt b = BigInt("98765432109876543210987654321") << 70;
+	for (const BigInt& y : { b, -b, a, BigInt(0), BigInt(-1), -(BigInt(1) << 128) })
+	{
+		EXPECT_EQ((a & y) + (a | y), a + y);
+		EXPECT_EQ(a ^ y, (a | y) - (a & y));
+		EXPECT_EQ(~(a & y), ~a | ~y);
+		EXPECT_EQ(~(a ^ y), ~a ^ y);
+	}
+	// The carry of ~x runs through every digit, the borrow back
+	const BigInt ones = (BigInt(1) << 128) - 1;
+	EXPECT_EQ(~ones, -(BigInt(1) << 128));
+	EXPECT_EQ(~~ones, ones);
+	EXPECT_EQ(~-(BigInt(1) << 128), ones);
+	EXPECT_EQ(~(ones + 0), -(BigInt(1) << 128));
+	EXPECT_EQ(~BigInt(-1), 0);
+	EXPECT_FALSE(~BigInt(-1) < 0);
+	EXPECT_EQ(a & -a, BigInt(1) << 0);
+	EXPECT_EQ(b & -b, BigInt(1) << 70);
+	EXPECT_EQ(-(BigInt(1) << 128) ^ (BigInt(1) << 128), -(BigInt(1) << 129));
+	BigInt x = a;
+	x &= x;
+	EXPECT_EQ(x, a);
+	x ^= x;
+	EXPECT_EQ(x, 0);
+	// Arithmetic right shift rounds towards negative infinity
+	EXPECT_EQ(a >> 77, (a - ((BigInt(1) << 77) - 1)) / (BigInt(1) << 77));
+	EXPECT_EQ(-(BigInt(1) << 200) >> 200, -1);
+	EXPECT_EQ((-(BigInt(1) << 200) - 1) >> 200, -2);
 }
\ No newline at end of file